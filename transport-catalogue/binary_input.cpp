@@ -0,0 +1,640 @@
+#include "binary_input.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace reader::binary
+{
+	namespace {
+		enum class Section : std::uint8_t {
+			BaseStops = 1,
+			BaseBuses = 2,
+			BaseDistances = 3,
+			StatRequests = 4,
+			RoutingSettings = 5,
+			RenderSettings = 6,
+			SerializationSettings = 7,
+		};
+
+		// optional fields of stat request, field is written only if it is not default
+		enum QueryField : std::uint32_t {
+			fieldName = 1 << 0,
+			fieldFrom = 1 << 1,
+			fieldTo = 1 << 2,
+			fieldLatitude = 1 << 3,
+			fieldLongitude = 1 << 4,
+			fieldRadius = 1 << 5,
+			fieldLimit = 1 << 6,
+			fieldText = 1 << 7,
+			fieldMaxEdits = 1 << 8,
+		};
+
+		const std::string stopType{ "Stop" };
+		const std::string busType{ "Bus" };
+
+		void PutUnsigned(std::string& out, std::uint64_t value) {
+			while (value >= 0x80) {
+				out.push_back(static_cast<char>(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+
+		class Encoder {
+		public:
+			void Unsigned(std::uint64_t value) {
+				PutUnsigned(section_, value);
+			}
+
+			void Signed(std::int64_t value) {
+				Unsigned((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+			}
+
+			void Double(double value) {
+				std::uint64_t bits = 0;
+				std::memcpy(&bits, &value, sizeof(bits));
+				for (int i = 0; i < 8; ++i) {
+					section_.push_back(static_cast<char>(bits >> (8 * i)));
+				}
+			}
+
+			// equal strings are kept in table once
+			void String(std::string_view str) {
+				const auto [it, added] = indexes_.emplace(str, static_cast<std::uint32_t>(strings_.size()));
+				if (added) {
+					strings_.push_back(str);
+				}
+				Unsigned(it->second);
+			}
+
+			void Color(const svg::Color& color) {
+				Unsigned(color.index());
+				if (const auto* name = std::get_if<std::string>(&color)) {
+					String(*name);
+				}
+				else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+					Unsigned(rgb->red);
+					Unsigned(rgb->green);
+					Unsigned(rgb->blue);
+				}
+				else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+					Unsigned(rgba->red);
+					Unsigned(rgba->green);
+					Unsigned(rgba->blue);
+					Double(rgba->opacity);
+				}
+			}
+
+			// payload written by write is prefixed by tag and its size
+			template <typename WriteFn>
+			void WriteSection(Section tag, WriteFn write) {
+				section_.clear();
+				write();
+				PutUnsigned(body_, static_cast<std::uint64_t>(tag));
+				PutUnsigned(body_, section_.size());
+				body_ += section_;
+			}
+
+			void Flush(std::ostream& output) const {
+				std::string head(magic);
+				PutUnsigned(head, version);
+				PutUnsigned(head, strings_.size());
+				for (const std::string_view str : strings_) {
+					PutUnsigned(head, str.size());
+					head += str;
+				}
+				output.write(head.data(), static_cast<std::streamsize>(head.size()));
+				output.write(body_.data(), static_cast<std::streamsize>(body_.size()));
+			}
+
+		private:
+			std::string body_;
+			std::string section_;
+			// strings refer to written data, it lives until document is flushed
+			std::vector<std::string_view> strings_;
+			std::unordered_map<std::string_view, std::uint32_t> indexes_;
+		};
+
+		class Decoder {
+		public:
+			explicit Decoder(std::string_view data)
+				: pos_(data.data()), end_(data.data() + data.size()) {
+			}
+
+			bool AtEnd() const {
+				return pos_ == end_;
+			}
+
+			std::uint64_t Unsigned() {
+				std::uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					if (pos_ == end_) {
+						throw std::runtime_error("Binary input is truncated");
+					}
+					const auto byte = static_cast<unsigned char>(*pos_++);
+					value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+					if (byte < 0x80) {
+						return value;
+					}
+				}
+				throw std::runtime_error("Binary input has too long varint");
+			}
+
+			std::int64_t Signed() {
+				const std::uint64_t value = Unsigned();
+				return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+			}
+
+			int Int() {
+				return static_cast<int>(Signed());
+			}
+
+			double Double() {
+				const std::string_view bytes = Bytes(8);
+				std::uint64_t bits = 0;
+				for (int i = 0; i < 8; ++i) {
+					bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+				}
+				double value = 0.0;
+				std::memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+
+			std::string_view Bytes(std::uint64_t size) {
+				if (size > static_cast<std::uint64_t>(end_ - pos_)) {
+					throw std::runtime_error("Binary input is truncated");
+				}
+				const std::string_view bytes(pos_, static_cast<std::size_t>(size));
+				pos_ += size;
+				return bytes;
+			}
+
+			std::string_view String() {
+				return (*strings_)[Index()];
+			}
+
+			// index of string in table
+			std::size_t Index() {
+				const std::uint64_t index = Unsigned();
+				if (strings_ == nullptr || index >= strings_->size()) {
+					throw std::runtime_error("Binary input refers to unknown string");
+				}
+				return static_cast<std::size_t>(index);
+			}
+
+			// number of following items, each takes at least one byte, so
+			// broken count can't make reader allocate more than size of input
+			std::size_t Count() {
+				const std::uint64_t count = Unsigned();
+				if (count > static_cast<std::uint64_t>(end_ - pos_)) {
+					throw std::runtime_error("Binary input is truncated");
+				}
+				return static_cast<std::size_t>(count);
+			}
+
+			svg::Color Color() {
+				switch (Unsigned()) {
+				case 1:
+					return std::string(String());
+				case 2: {
+					svg::Rgb rgb;
+					rgb.red = static_cast<std::uint8_t>(Unsigned());
+					rgb.green = static_cast<std::uint8_t>(Unsigned());
+					rgb.blue = static_cast<std::uint8_t>(Unsigned());
+					return rgb;
+				}
+				case 3: {
+					svg::Rgba rgba;
+					rgba.red = static_cast<std::uint8_t>(Unsigned());
+					rgba.green = static_cast<std::uint8_t>(Unsigned());
+					rgba.blue = static_cast<std::uint8_t>(Unsigned());
+					rgba.opacity = Double();
+					return rgba;
+				}
+				default:
+					return svg::Color{};
+				}
+			}
+
+			// decoder of next size bytes, they are skipped by this one
+			Decoder Sub(std::uint64_t size) {
+				Decoder sub(Bytes(size));
+				sub.strings_ = strings_;
+				return sub;
+			}
+
+			void SetStrings(const std::vector<std::string_view>& strings) {
+				strings_ = &strings;
+			}
+
+		private:
+			const char* pos_;
+			const char* end_;
+			const std::vector<std::string_view>* strings_ = nullptr;
+		};
+
+		// head of document is checked, then each section is passed to visit
+		// together with table of strings it refers to
+		template <typename Visit>
+		void ReadSections(std::string_view data, Visit visit) {
+			Decoder decoder(data);
+			if (decoder.Bytes(magic.size()) != magic) {
+				throw std::runtime_error("Input is not binary document");
+			}
+			if (decoder.Unsigned() != version) {
+				throw std::runtime_error("Unsupported version of binary input");
+			}
+			std::vector<std::string_view> strings(decoder.Count());
+			for (std::string_view& str : strings) {
+				str = decoder.Bytes(decoder.Unsigned());
+			}
+			decoder.SetStrings(strings);
+
+			while (!decoder.AtEnd()) {
+				const std::uint64_t tag = decoder.Unsigned();
+				Decoder section = decoder.Sub(decoder.Unsigned());
+				visit(static_cast<Section>(tag), section, strings);
+			}
+		}
+
+		void WriteOffset(Encoder& encoder, const std::vector<double>& offset) {
+			encoder.Unsigned(offset.size());
+			for (const double value : offset) {
+				encoder.Double(value);
+			}
+		}
+
+		std::vector<double> ReadOffset(Decoder& decoder) {
+			std::vector<double> offset(decoder.Count());
+			for (double& value : offset) {
+				value = decoder.Double();
+			}
+			return offset;
+		}
+
+		void WriteQuery(Encoder& encoder, const detail::Query& query) {
+			// name of stat request belongs to bus only in Bus request
+			const std::string& name = query.typeOfQuery == busType ? query.nameBus : query.nameStop;
+			std::uint32_t fields = 0;
+			if (!name.empty()) {
+				fields |= fieldName;
+			}
+			if (!query.from.empty()) {
+				fields |= fieldFrom;
+			}
+			if (!query.to.empty()) {
+				fields |= fieldTo;
+			}
+			if (query.latitude != 0.0) {
+				fields |= fieldLatitude;
+			}
+			if (query.longitude != 0.0) {
+				fields |= fieldLongitude;
+			}
+			if (query.radius != 0.0) {
+				fields |= fieldRadius;
+			}
+			if (query.limit != 0) {
+				fields |= fieldLimit;
+			}
+			if (!query.text.empty()) {
+				fields |= fieldText;
+			}
+			if (query.maxEdits != 0) {
+				fields |= fieldMaxEdits;
+			}
+
+			encoder.String(query.typeOfQuery);
+			encoder.Signed(query.id_query);
+			encoder.Unsigned(fields);
+			if (fields & fieldName) {
+				encoder.String(name);
+			}
+			if (fields & fieldFrom) {
+				encoder.String(query.from);
+			}
+			if (fields & fieldTo) {
+				encoder.String(query.to);
+			}
+			if (fields & fieldLatitude) {
+				encoder.Double(query.latitude);
+			}
+			if (fields & fieldLongitude) {
+				encoder.Double(query.longitude);
+			}
+			if (fields & fieldRadius) {
+				encoder.Double(query.radius);
+			}
+			if (fields & fieldLimit) {
+				encoder.Signed(query.limit);
+			}
+			if (fields & fieldText) {
+				encoder.String(query.text);
+			}
+			if (fields & fieldMaxEdits) {
+				encoder.Signed(query.maxEdits);
+			}
+		}
+
+		detail::Query ReadQuery(Decoder& decoder) {
+			detail::Query query;
+			query.typeOfQuery = decoder.String();
+			query.type = detail::GetQueryType(query.typeOfQuery);
+			query.id_query = decoder.Int();
+			const std::uint64_t fields = decoder.Unsigned();
+			if (fields & fieldName) {
+				(query.typeOfQuery == busType ? query.nameBus : query.nameStop) = decoder.String();
+			}
+			if (fields & fieldFrom) {
+				query.from = decoder.String();
+			}
+			if (fields & fieldTo) {
+				query.to = decoder.String();
+			}
+			if (fields & fieldLatitude) {
+				query.latitude = decoder.Double();
+			}
+			if (fields & fieldLongitude) {
+				query.longitude = decoder.Double();
+			}
+			if (fields & fieldRadius) {
+				query.radius = decoder.Double();
+			}
+			if (fields & fieldLimit) {
+				query.limit = decoder.Int();
+			}
+			if (fields & fieldText) {
+				query.text = decoder.String();
+			}
+			if (fields & fieldMaxEdits) {
+				query.maxEdits = decoder.Int();
+			}
+			return query;
+		}
+
+		void WriteRenderSettings(Encoder& encoder, const renderer::Settings& setup) {
+			encoder.Double(setup.width);
+			encoder.Double(setup.height);
+			encoder.Double(setup.padding);
+			encoder.Double(setup.line_width);
+			encoder.Double(setup.stop_radius);
+			encoder.Signed(setup.bus_label_font_size);
+			WriteOffset(encoder, setup.bus_label_offset);
+			encoder.Signed(setup.stop_label_font_size);
+			WriteOffset(encoder, setup.stop_label_offset);
+			encoder.Color(setup.underlayer_color);
+			encoder.Double(setup.underlayer_width);
+			encoder.Unsigned(setup.color_palette.size());
+			for (const svg::Color& color : setup.color_palette) {
+				encoder.Color(color);
+			}
+		}
+
+		void ReadRenderSettings(Decoder& decoder, renderer::Settings& setup) {
+			setup.width = decoder.Double();
+			setup.height = decoder.Double();
+			setup.padding = decoder.Double();
+			setup.line_width = decoder.Double();
+			setup.stop_radius = decoder.Double();
+			setup.bus_label_font_size = decoder.Int();
+			setup.bus_label_offset = ReadOffset(decoder);
+			setup.stop_label_font_size = decoder.Int();
+			setup.stop_label_offset = ReadOffset(decoder);
+			setup.underlayer_color = decoder.Color();
+			setup.underlayer_width = decoder.Double();
+			const std::size_t colors = decoder.Count();
+			setup.color_palette.clear();
+			setup.color_palette.reserve(colors);
+			for (std::size_t i = 0; i < colors; ++i) {
+				setup.color_palette.push_back(decoder.Color());
+			}
+		}
+	}
+
+	bool IsBinary(std::istream& input)
+	{
+		return input.peek() == static_cast<unsigned char>(magic.front());
+	}
+
+	void Write(std::ostream& output, const ResponseData& data, const renderer::Settings& setup)
+	{
+		const auto& [queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase] = data;
+		Encoder encoder;
+
+		encoder.WriteSection(Section::BaseStops, [&] {
+			const auto count = std::count_if(queriesToAdd.begin(), queriesToAdd.end(),
+				[](const detail::Query& query) { return query.typeOfQuery == stopType; });
+			encoder.Unsigned(static_cast<std::uint64_t>(count));
+			for (const detail::Query& query : queriesToAdd) {
+				if (query.typeOfQuery == stopType) {
+					encoder.String(query.nameStop);
+					encoder.Double(query.latitude);
+					encoder.Double(query.longitude);
+				}
+			}
+		});
+		encoder.WriteSection(Section::BaseBuses, [&] {
+			const auto count = std::count_if(queriesToAdd.begin(), queriesToAdd.end(),
+				[](const detail::Query& query) { return query.typeOfQuery == busType; });
+			encoder.Unsigned(static_cast<std::uint64_t>(count));
+			for (const detail::Query& query : queriesToAdd) {
+				if (query.typeOfQuery == busType) {
+					encoder.String(query.nameBus);
+					encoder.Unsigned(query.isRing ? 1 : 0);
+					encoder.Unsigned(query.routeStops.size());
+					for (const std::string& stop : query.routeStops) {
+						encoder.String(stop);
+					}
+				}
+			}
+		});
+		encoder.WriteSection(Section::BaseDistances, [&] {
+			std::size_t count = 0;
+			for (const auto& stops : queryTowardStop) {
+				count += stops.size();
+			}
+			encoder.Unsigned(count);
+			for (const auto& stops : queryTowardStop) {
+				for (const auto& [from, distances] : stops) {
+					encoder.String(from);
+					encoder.Unsigned(distances.size());
+					for (const detail::Distance& distance : distances) {
+						encoder.String(distance.to);
+						encoder.Signed(distance.distance);
+					}
+				}
+			}
+		});
+		encoder.WriteSection(Section::StatRequests, [&] {
+			encoder.Unsigned(queriesToBase.size());
+			for (const detail::Query& query : queriesToBase) {
+				WriteQuery(encoder, query);
+			}
+		});
+		encoder.WriteSection(Section::RoutingSettings, [&] {
+			encoder.Double(routeSettings.velocity);
+			encoder.Signed(routeSettings.waitTime);
+		});
+		encoder.WriteSection(Section::RenderSettings, [&] {
+			WriteRenderSettings(encoder, setup);
+		});
+		encoder.WriteSection(Section::SerializationSettings, [&] {
+			encoder.String(nameBase);
+		});
+
+		encoder.Flush(output);
+	}
+
+	ResponseData Read(std::istream& input, renderer::Settings& setup)
+	{
+		ResponseData result;
+		auto& [queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase] = result;
+		routeSettings = detail::RouteSet{};
+		// stops go before buses as JsonReader puts them
+		std::deque<detail::Query> buses;
+		ReadSections(json::ReadAll(input), [&](Section tag, Decoder& section, const auto&) {
+			switch (tag) {
+			case Section::BaseStops:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					detail::Query stop;
+					stop.typeOfQuery = stopType;
+					stop.nameStop = section.String();
+					stop.latitude = section.Double();
+					stop.longitude = section.Double();
+					queriesToAdd.push_back(std::move(stop));
+				}
+				break;
+			case Section::BaseBuses:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					detail::Query bus;
+					bus.typeOfQuery = busType;
+					bus.nameBus = section.String();
+					bus.isRing = section.Unsigned() != 0;
+					bus.routeStops.resize(section.Count());
+					for (std::string& stop : bus.routeStops) {
+						stop = section.String();
+					}
+					buses.push_back(std::move(bus));
+				}
+				break;
+			case Section::BaseDistances:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					std::unordered_map<std::string, std::vector<detail::Distance>> stop;
+					std::vector<detail::Distance>& distances = stop[std::string(section.String())];
+					distances.resize(section.Count());
+					for (detail::Distance& distance : distances) {
+						distance.to = section.String();
+						distance.distance = section.Int();
+					}
+					queryTowardStop.push_back(std::move(stop));
+				}
+				break;
+			case Section::StatRequests:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					queriesToBase.push_back(ReadQuery(section));
+				}
+				break;
+			case Section::RoutingSettings:
+				routeSettings.velocity = section.Double();
+				routeSettings.waitTime = section.Int();
+				break;
+			case Section::RenderSettings:
+				ReadRenderSettings(section, setup);
+				break;
+			case Section::SerializationSettings:
+				nameBase = section.String();
+				break;
+			default:
+				break;
+			}
+		});
+		std::move(buses.begin(), buses.end(), std::back_inserter(queriesToAdd));
+		return result;
+	}
+
+	ResponseData ReadRequests(std::istream& input)
+	{
+		ResponseData result;
+		auto& [queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase] = result;
+		routeSettings = detail::RouteSet{};
+		ReadSections(json::ReadAll(input), [&](Section tag, Decoder& section, const auto&) {
+			if (tag == Section::StatRequests) {
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					queriesToBase.push_back(ReadQuery(section));
+				}
+			}
+			else if (tag == Section::SerializationSettings) {
+				nameBase = section.String();
+			}
+		});
+		return result;
+	}
+
+	detail::BaseData ReadBase(std::istream& input, renderer::Settings& setup)
+	{
+		detail::BaseData base;
+		// names of table are copied to base once, when they are met first time
+		std::vector<std::string_view> names;
+		auto readName = [&base, &names](Decoder& section, const std::vector<std::string_view>& strings) {
+			if (names.size() != strings.size()) {
+				names.resize(strings.size());
+			}
+			const std::size_t index = section.Index();
+			if (names[index].data() == nullptr) {
+				names[index] = *base.names.emplace(strings[index]).first;
+			}
+			return names[index];
+		};
+		ReadSections(json::ReadAll(input), [&](Section tag, Decoder& section, const auto& strings) {
+			switch (tag) {
+			case Section::BaseStops:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					tc::StopData stop{ readName(section, strings) };
+					stop.latitude = section.Double();
+					stop.longitude = section.Double();
+					base.stops.push_back(stop);
+				}
+				break;
+			case Section::BaseBuses:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					const std::string_view nameBus = readName(section, strings);
+					const bool isRing = section.Unsigned() != 0;
+					std::vector<std::string_view> routeStops(section.Count());
+					for (std::string_view& stop : routeStops) {
+						stop = readName(section, strings);
+					}
+					base.buses.push_back({ nameBus, tc::MakeFullRoute(std::move(routeStops), isRing), isRing });
+				}
+				break;
+			case Section::BaseDistances:
+				for (std::size_t count = section.Count(); count > 0; --count) {
+					const std::string_view from = readName(section, strings);
+					for (std::size_t distances = section.Count(); distances > 0; --distances) {
+						const std::string_view to = readName(section, strings);
+						base.distances.push_back({ from, to, static_cast<unsigned int>(section.Int()) });
+					}
+				}
+				break;
+			case Section::RoutingSettings:
+				base.routeSettings.velocity = section.Double();
+				base.routeSettings.waitTime = section.Int();
+				break;
+			case Section::RenderSettings:
+				ReadRenderSettings(section, setup);
+				break;
+			case Section::SerializationSettings:
+				base.nameBase = section.String();
+				break;
+			default:
+				break;
+			}
+		});
+		return base;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "json_reader.h"
+#include "map_renderer.h"
+
+#include <iostream>
+#include <string_view>
+
+namespace reader::binary
+{
+	// compact input for machine-to-machine traffic, the same document as JSON input:
+	//   magic, format version
+	//   table of strings: count, then size and bytes of each string
+	//   sections up to end of input: tag, size of payload, payload
+	// integers are varints (signed ones zigzag-encoded), doubles are 8 bytes of
+	// IEEE 754 value in little-endian order, strings are indexes in table.
+	// Unknown sections are skipped by their size
+	inline constexpr std::string_view magic{ "\0TCB", 4 };
+	inline constexpr unsigned int version = 1;
+
+	// JSON text can't start with zero byte, so first byte is enough to tell them apart
+	bool IsBinary(std::istream& input);
+
+	// data read from JSON input is written as binary document
+	void Write(std::ostream& output, const ResponseData& data, const renderer::Settings& setup);
+	// the same result as JsonReader::ReadData gives for JSON document
+	ResponseData Read(std::istream& input, renderer::Settings& setup);
+	// the same result as JsonReader::ReadRequests gives, other sections are skipped
+	ResponseData ReadRequests(std::istream& input);
+	// the same result as JsonReader::ReadBase gives, stat requests are skipped
+	detail::BaseData ReadBase(std::istream& input, renderer::Settings& setup);
+}
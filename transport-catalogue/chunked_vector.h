@@ -0,0 +1,129 @@
+#pragma once
+
+#include "memory_stats.h"
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace chunked
+{
+	// vector kept in chunks of fixed size, copy of vector shares chunks with original
+	// and chunk is copied by the first change of its item in one of them. So copy
+	// and change of few items cost number of chunks instead of number of items
+	template <typename T>
+	class Vector {
+	public:
+		static constexpr std::size_t chunkSize = 1024;
+
+		class ConstIterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T*;
+			using reference = const T&;
+
+			ConstIterator(const Vector* vec, std::size_t index)
+				: vec_(vec)
+				, index_(index) {
+			}
+			const T& operator*() const {
+				return (*vec_)[index_];
+			}
+			const T* operator->() const {
+				return &(*vec_)[index_];
+			}
+			ConstIterator& operator++() {
+				++index_;
+				return *this;
+			}
+			bool operator==(const ConstIterator& other) const {
+				return index_ == other.index_;
+			}
+			bool operator!=(const ConstIterator& other) const {
+				return index_ != other.index_;
+			}
+
+		private:
+			const Vector* vec_;
+			std::size_t index_;
+		};
+
+		std::size_t size() const {
+			return size_;
+		}
+		bool empty() const {
+			return size_ == 0;
+		}
+		const T& operator[](std::size_t index) const {
+			return (*chunks_[index / chunkSize])[index % chunkSize];
+		}
+		ConstIterator begin() const {
+			return ConstIterator(this, 0);
+		}
+		ConstIterator end() const {
+			return ConstIterator(this, size_);
+		}
+
+		// item to change, its chunk is copied first if other vector shares it
+		T& Mutable(std::size_t index) {
+			return OwnChunk(index / chunkSize)[index % chunkSize];
+		}
+		void push_back(T item) {
+			if (size_ % chunkSize == 0) {
+				chunks_.push_back(std::make_shared<Chunk>());
+				chunks_.back()->reserve(chunkSize);
+			}
+			OwnChunk(chunks_.size() - 1).push_back(std::move(item));
+			++size_;
+		}
+		// new items are default ones
+		void resize(std::size_t size) {
+			while (size_ < size) {
+				push_back(T{});
+			}
+			if (size < size_) {
+				chunks_.resize((size + chunkSize - 1) / chunkSize);
+				if (size % chunkSize != 0) {
+					OwnChunk(chunks_.size() - 1).resize(size % chunkSize);
+				}
+				size_ = size;
+			}
+		}
+
+		// items themselves are counted by owner of vector
+		void CountMemory(memory::Counter& counter) const {
+			counter.AddVector(chunks_);
+			for (const auto& chunk : chunks_) {
+				counter.AddShared(sizeof(Chunk));
+				counter.AddVector(*chunk);
+			}
+		}
+
+	private:
+		using Chunk = std::vector<T>;
+
+		std::vector<std::shared_ptr<Chunk>> chunks_;
+		std::size_t size_{ 0 };
+
+		Chunk& OwnChunk(std::size_t index) {
+			std::shared_ptr<Chunk>& chunk = chunks_[index];
+			// vectors are copied only by thread changing them, other threads may only
+			// drop their copies, so count can be greater than real one but never less
+			if (chunk.use_count() > 1) {
+				auto copy = std::make_shared<Chunk>();
+				copy->reserve(chunkSize);
+				copy->assign(chunk->begin(), chunk->end());
+				chunk = std::move(copy);
+			}
+			else {
+				// reads of dropped copies happen before the change
+				std::atomic_thread_fence(std::memory_order_acquire);
+			}
+			return *chunk;
+		}
+	};
+}
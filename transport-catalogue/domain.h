@@ -12,6 +12,7 @@ namespace domain
 		std::string nameStop;
 		double latitude;
 		double longitude;
+		std::size_t idStop{ 0 }; // index of stop in catalogue, assigned when stop is added
 	};
 
 	struct Bus {
@@ -0,0 +1,29 @@
+#include "format.h"
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+
+namespace format {
+	std::string_view FormatDouble(double value, int precision, DoubleBuffer& buffer)
+	{
+		char* const first = buffer.data();
+		char* const last = buffer.data() + buffer.size();
+		const std::to_chars_result result = precision == shortest
+			? std::to_chars(first, last, value)
+			: std::to_chars(first, last, value, std::chars_format::general, std::min(precision, maxPrecision));
+		return { first, static_cast<std::size_t>(result.ptr - first) };
+	}
+
+	void WriteDouble(std::ostream& out, double value)
+	{
+		WriteDouble(out, value, static_cast<int>(out.precision()));
+	}
+
+	void WriteDouble(std::ostream& out, double value, int precision)
+	{
+		DoubleBuffer buffer;
+		const std::string_view text = FormatDouble(value, precision, buffer);
+		out.write(text.data(), static_cast<std::streamsize>(text.size()));
+	}
+}
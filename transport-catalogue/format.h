@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include <iosfwd>
+#include <string_view>
+
+namespace format {
+	// precision giving the shortest text which is read back as the same double
+	inline constexpr int shortest = -1;
+	// larger precision is cut to it, such digits are never significant
+	inline constexpr int maxPrecision = 48;
+
+	using DoubleBuffer = std::array<char, 64>;
+
+	// text of double as printf("%.*g") makes it in C locale, or the shortest
+	// round-trip one. Text is placed into buffer
+	std::string_view FormatDouble(double value, int precision, DoubleBuffer& buffer);
+
+	// double in default float format of stream with its precision,
+	// numbers are written without locale and without stream formatting
+	void WriteDouble(std::ostream& out, double value);
+	void WriteDouble(std::ostream& out, double value, int precision);
+}
@@ -7,15 +7,68 @@ const unsigned int earthRadius = 6'371'000;
 
 namespace geo {
 
+	namespace {
+		// arc between points is 2 * asin(h), where h is half of chord between them.
+		// For short segments asin is replaced by its series, terms up to h^9 keep
+		// double precision while h <= maxSeriesArg (segments up to ~600 km)
+		const double maxSeriesArg = 0.05;
+		const double c3 = 1.0 / 6.0;
+		const double c5 = 3.0 / 40.0;
+		const double c7 = 15.0 / 336.0;
+		const double c9 = 105.0 / 3456.0;
+
+		double HalfChord(const UnitVector& from, const UnitVector& to) {
+			const double dx = to.x - from.x;
+			const double dy = to.y - from.y;
+			const double dz = to.z - from.z;
+			return 0.5 * std::sqrt(dx * dx + dy * dy + dz * dz);
+		}
+
+		double SeriesArc(double h) {
+			const double h2 = h * h;
+			return 2.0 * h * (1.0 + h2 * (c3 + h2 * (c5 + h2 * (c7 + h2 * c9))));
+		}
+
+		double Arc(double h) {
+			return h > maxSeriesArg ? 2.0 * std::asin(std::fmin(h, 1.0)) : SeriesArc(h);
+		}
+	}
+
+	UnitVector ToUnitVector(Coordinates point) {
+		static const double dr = M_PI / 180.;
+		const double cos_lat = std::cos(point.lat * dr);
+		return { cos_lat * std::cos(point.lng * dr), cos_lat * std::sin(point.lng * dr),
+			std::sin(point.lat * dr) };
+	}
+
 	double ComputeDistance(Coordinates from, Coordinates to) {
-		using namespace std;
 		if (from == to) {
 			return 0;
 		}
-		static const double dr = M_PI / 180.;
-		return acos(sin(from.lat * dr) * sin(to.lat * dr)
-			+ cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-			* earthRadius;
+		const UnitVector points[] = { ToUnitVector(from), ToUnitVector(to) };
+		return ComputeRouteDistance(points, 2);
+	}
+
+	double ComputeDistance(const UnitVector& from, const UnitVector& to) {
+		return Arc(HalfChord(from, to)) * earthRadius;
+	}
+
+	double ComputeRouteDistance(const UnitVector* points, std::size_t count) {
+		double result{ 0.0 };
+		bool hasLong = false;
+		for (std::size_t i = 0; i + 1 < count; ++i) {
+			const double h = HalfChord(points[i], points[i + 1]);
+			hasLong |= h > maxSeriesArg;
+			result += SeriesArc(h);
+		}
+		// route with long segments is summed once more by asin
+		if (hasLong) {
+			result = 0.0;
+			for (std::size_t i = 0; i + 1 < count; ++i) {
+				result += Arc(HalfChord(points[i], points[i + 1]));
+			}
+		}
+		return result * earthRadius;
 	}
 
 }  // namespace geo
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 namespace geo {
 
 	struct Coordinates {
@@ -13,6 +15,19 @@ namespace geo {
 		}
 	};
 
+	// point on sphere of unit radius, trigonometry of coordinates is computed once per point
+	struct UnitVector {
+		double x;
+		double y;
+		double z;
+	};
+
+	UnitVector ToUnitVector(Coordinates point);
+
 	double ComputeDistance(Coordinates from, Coordinates to);
+	double ComputeDistance(const UnitVector& from, const UnitVector& to);
+
+	// computes length of route through all points in one pass
+	double ComputeRouteDistance(const UnitVector* points, std::size_t count);
 
 }  // namespace geo
\ No newline at end of file
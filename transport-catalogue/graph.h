@@ -32,6 +32,8 @@ namespace graph {
 		explicit DirectedWeightedGraph(std::vector<Edge<Weight>> edges,
 			std::vector<std::vector<EdgeId>> incidence_lists);
 		EdgeId AddEdge(const Edge<Weight>& edge);
+		// new vertex gets id equal to number of vertices before it
+		VertexId AddVertex();
 		
 		size_t GetVertexCount() const;
 		size_t GetEdgeCount() const;
@@ -62,6 +64,12 @@ namespace graph {
 		return id;
 	}
 
+	template <typename Weight>
+	VertexId DirectedWeightedGraph<Weight>::AddVertex() {
+		incidence_lists_.emplace_back();
+		return incidence_lists_.size() - 1;
+	}
+
 	template <typename Weight>
 	size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
 		return incidence_lists_.size();
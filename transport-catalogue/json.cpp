@@ -1,6 +1,17 @@
 #include "json.h"
+#include "format.h"
 
+#include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -8,218 +19,1215 @@ namespace json {
 
 	namespace {
 
-		Node LoadNode(istream& input);
+		// whitespace skipped between tokens, the same set as operator>> skips
+		bool IsSpace(char ch) {
+			return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+		}
 
-		Node LoadArray(istream& input) {
-			Array result;
+		bool IsDigit(char ch) {
+			return ch >= '0' && ch <= '9';
+		}
 
-			for (char c; input >> c && c != ']';) {
-				if (c != ',') {
-					input.putback(c);
+		// first quote or backslash in [pos, end), end if there is none
+		const char* FindQuoteOrEscape(const char* pos, const char* end) {
+#ifdef __SSE2__
+			const __m128i quote = _mm_set1_epi8('"');
+			const __m128i escape = _mm_set1_epi8('\\');
+			for (; end - pos >= 16; pos += 16) {
+				const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+				const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+					_mm_cmpeq_epi8(block, escape)));
+				if (mask != 0) {
+					return pos + __builtin_ctz(static_cast<unsigned>(mask));
 				}
-				result.push_back(LoadNode(input));
 			}
-			if (!input) {
-				throw ParsingError("Array Error!");
+#endif
+			for (; pos != end; ++pos) {
+				if (*pos == '"' || *pos == '\\') {
+					return pos;
+				}
 			}
+			return end;
+		}
 
-			return Node(move(result));
+		// character of escape sequence after backslash is appended to line as it means
+		void AppendEscaped(string& line, char ch) {
+			switch (ch) {
+			case '"':
+				line.push_back('"');
+				break;
+			case '\\':
+				line.push_back('\\');
+				break;
+			case 'n':
+				line.push_back('\n');
+				break;
+			case 'r':
+				line.push_back('\r');
+				break;
+			case 't':
+				line.push_back('\t');
+				break;
+			default:
+				throw ParsingError("invalid escape character!"s);
+			}
 		}
 
-		Node LoadString(istream& input) {
-			string line;
-			int numQoutes = 1;
-			while (input.peek() != EOF) {
-				char ch = input.get();
-				if (ch == '"') {
-					++numQoutes;
+		// number of checked grammar in [begin, end)
+		Node MakeNumber(const char* begin, const char* end, bool is_int) {
+			if (is_int) {
+				int value = 0;
+				const auto [ptr, ec] = from_chars(begin, end, value);
+				if (ec == errc{} && ptr == end) {
+					return Node(value);
+				}
+				// int overflow falls back to double
+			}
+			double value = 0.0;
+			const auto [ptr, ec] = from_chars(begin, end, value);
+			if (ec != errc{} || ptr != end) {
+				throw ParsingError("Failed to convert "s + string(begin, end) + " to number"s);
+			}
+			return Node(value);
+		}
+
+		// only arrays of root and of its members are split between threads
+		const size_t parallelDepth = 2;
+		// smaller arrays are not worth starting threads
+		const ptrdiff_t minParallelBytes = 1 << 20;
+		// array is cut only at elements which are not closer than this
+		const ptrdiff_t minChunkBytes = 1 << 16;
+
+		// array found by structural scan without parsing: parts start after commas
+		// between its elements, end is its closing bracket
+		struct ArraySplit {
+			vector<const char*> parts;
+			const char* end = nullptr;
+		};
+
+		// bits of chars of 64-byte block which matter for structure of document
+		struct BlockBits {
+			uint64_t quotes = 0;
+			uint64_t escapes = 0;
+			uint64_t opens = 0;
+			uint64_t closes = 0;
+			uint64_t commas = 0;
+		};
+
+		BlockBits ClassifyBlock(const char* block) {
+			BlockBits bits;
+#ifdef __SSE2__
+			for (int i = 0; i < 4; ++i) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+				auto mask = [&chunk, i](char ch) {
+					const int found = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(ch)));
+					return static_cast<uint64_t>(static_cast<unsigned>(found)) << (16 * i);
+				};
+				bits.quotes |= mask('"');
+				bits.escapes |= mask('\\');
+				bits.opens |= mask('[') | mask('{');
+				bits.closes |= mask(']') | mask('}');
+				bits.commas |= mask(',');
+			}
+#else
+			for (int i = 0; i < 64; ++i) {
+				const uint64_t bit = uint64_t{ 1 } << i;
+				switch (block[i]) {
+				case '"':
+					bits.quotes |= bit;
+					break;
+				case '\\':
+					bits.escapes |= bit;
+					break;
+				case '[':
+				case '{':
+					bits.opens |= bit;
+					break;
+				case ']':
+				case '}':
+					bits.closes |= bit;
+					break;
+				case ',':
+					bits.commas |= bit;
+					break;
+				default:
 					break;
 				}
-				if (ch == '\\') {
-					input.get(ch);
-					switch (ch) {
-					case '"': {
-						line.push_back('"');
-						break;
+			}
+#endif
+			return bits;
+		}
+
+		// index of lowest set bit, bits must not be 0
+		int LowestBit(uint64_t bits) {
+#ifdef __GNUC__
+			return __builtin_ctzll(bits);
+#else
+			int index = 0;
+			for (; (bits & 1) == 0; bits >>= 1) {
+				++index;
+			}
+			return index;
+#endif
+		}
+
+		// bits from first up to last, last is not included
+		uint64_t RangeBits(int first, int last) {
+			const uint64_t below = last == 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << last) - 1;
+			return below & ~((uint64_t{ 1 } << first) - 1);
+		}
+
+		// array is cut at commas nearest to equal shares of it
+		ArraySplit MakeSplit(const char* begin, const char* end, const vector<const char*>& commas, size_t maxParts) {
+			ArraySplit split;
+			split.end = end;
+			split.parts.push_back(begin);
+			const ptrdiff_t share = (end - begin) / static_cast<ptrdiff_t>(maxParts);
+			auto it = commas.begin();
+			for (size_t part = 1; part < maxParts; ++part) {
+				it = lower_bound(it, commas.end(), begin + share * static_cast<ptrdiff_t>(part));
+				if (it == commas.end()) {
+					break;
+				}
+				split.parts.push_back(*it++ + 1);
+			}
+			return split;
+		}
+
+		// bracket closing container opened just before pos, nullptr if it is not found.
+		// Commas between elements of container are passed to onComma. Text is scanned
+		// by 64-byte blocks: chars inside strings are masked out by prefix xor of
+		// unescaped quotes, so only brackets and commas of document are visited one by one
+		template <typename OnComma>
+		const char* FindClose(const char* pos, const char* end, OnComma onComma) {
+			size_t depth = 0;
+			// all bits are set if previous block ends inside string
+			uint64_t inString = 0;
+			bool escaped = false;
+			char tail[64];
+			for (; pos < end; pos += 64) {
+				const char* block = pos;
+				if (end - pos < 64) {
+					memset(tail, ' ', sizeof(tail));
+					memcpy(tail, pos, end - pos);
+					block = tail;
+				}
+				const BlockBits bits = ClassifyBlock(block);
+
+				// backslashes are rare, so they are walked in order
+				uint64_t escapedBits = escaped ? 1 : 0;
+				escaped = false;
+				for (uint64_t backslashes = bits.escapes; backslashes != 0; backslashes &= backslashes - 1) {
+					const int i = LowestBit(backslashes);
+					if ((escapedBits >> i & 1) != 0) {
+						continue;
+					}
+					if (i == 63) {
+						escaped = true;
 					}
-					case '\\': {
-						line.push_back('\\');
+					else {
+						escapedBits |= uint64_t{ 1 } << (i + 1);
+					}
+				}
+				uint64_t strings = bits.quotes & ~escapedBits;
+				for (int shift = 1; shift < 64; shift *= 2) {
+					strings ^= strings << shift;
+				}
+				strings ^= inString;
+				inString = static_cast<uint64_t>(static_cast<int64_t>(strings) >> 63);
+
+				uint64_t brackets = (bits.opens | bits.closes) & ~strings;
+				const uint64_t commaBits = bits.commas & ~strings;
+				int from = 0;
+				while (true) {
+					const int next = brackets != 0 ? LowestBit(brackets) : 64;
+					if (depth == 0 && next > from) {
+						for (uint64_t rest = commaBits & RangeBits(from, next); rest != 0; rest &= rest - 1) {
+							onComma(pos + LowestBit(rest));
+						}
+					}
+					if (next == 64) {
 						break;
 					}
-					case 'n': {
-						line.push_back('\n');
+					brackets &= brackets - 1;
+					if ((bits.opens >> next & 1) != 0) {
+						++depth;
+					}
+					else if (depth != 0) {
+						--depth;
+					}
+					else {
+						return pos + next;
+					}
+					from = next + 1;
+				}
+			}
+			return nullptr;
+		}
+
+		// pos is next after opening bracket, nullopt if array is not closed properly,
+		// then the usual parser reports the error
+		optional<ArraySplit> SplitArray(const char* pos, const char* end, size_t maxParts) {
+			vector<const char*> commas;
+			const char* lastComma = pos;
+			const char* close = FindClose(pos, end, [&commas, &lastComma](const char* comma) {
+				if (comma - lastComma >= minChunkBytes) {
+					commas.push_back(comma);
+					lastComma = comma;
+				}
+			});
+			if (close == nullptr || *close != ']') {
+				return nullopt;
+			}
+			return MakeSplit(pos, close, commas, maxParts);
+		}
+
+		// task(i) for i in [0, count), the first one runs on current thread. Error
+		// of the earliest failed task is rethrown after all of them are finished
+		template <typename Task>
+		void RunParallel(size_t count, Task task) {
+			vector<exception_ptr> errors(count);
+			auto run = [&task, &errors](size_t i) {
+				try {
+					task(i);
+				}
+				catch (...) {
+					errors[i] = current_exception();
+				}
+			};
+			vector<thread> workers;
+			workers.reserve(count);
+			for (size_t i = 1; i < count; ++i) {
+				workers.emplace_back(run, i);
+			}
+			run(0);
+			for (thread& worker : workers) {
+				worker.join();
+			}
+			for (const exception_ptr& error : errors) {
+				if (error) {
+					rethrow_exception(error);
+				}
+			}
+		}
+
+		// recursive descent over text kept in one buffer
+		class Parser {
+		public:
+			// large arrays near root are parsed by up to threads threads
+			explicit Parser(string_view text, size_t threads = 1)
+				: pos_(text.data()), end_(text.data() + text.size()), threads_(threads) {
+			}
+
+			Node LoadNode() {
+				SkipSpaces();
+				if (pos_ == end_) {
+					throw ParsingError("Input is empty"s);
+				}
+				switch (*pos_) {
+				case '[':
+					++pos_;
+					if (threads_ > 1 && depth_ < parallelDepth) {
+						return LoadArrayParallel();
+					}
+					return LoadArray();
+				case '{':
+					++pos_;
+					return LoadDict();
+				default:
+					return LoadScalar();
+				}
+			}
+
+			// the same as LoadNode, but parts of document are passed to handler
+			void Parse(Handler& handler) {
+				SkipSpaces();
+				if (pos_ == end_) {
+					throw ParsingError("Input is empty"s);
+				}
+				switch (*pos_) {
+				case '[':
+					++pos_;
+					ParseArray(handler);
+					break;
+				case '{':
+					++pos_;
+					ParseDict(handler);
+					break;
+				default:
+					handler.Value(LoadScalar());
+				}
+			}
+
+		protected:
+			const char* pos_;
+			const char* end_;
+			size_t threads_;
+			// number of containers opened at current position
+			size_t depth_ = 0;
+
+			// part of array between separating commas, there is no closing bracket
+			template <typename Element, typename LoadElement>
+			void LoadElements(vector<Element>& elements, LoadElement load) {
+				while (true) {
+					elements.push_back(load());
+					SkipSpaces();
+					if (pos_ == end_) {
+						return;
+					}
+					if (*pos_++ != ',') {
+						throw ParsingError("Array Error!");
+					}
+				}
+			}
+
+			optional<ArraySplit> SplitLargeArray() const {
+				if (end_ - pos_ < minParallelBytes) {
+					return nullopt;
+				}
+				const size_t maxParts = min<size_t>(threads_, (end_ - pos_) / minChunkBytes);
+				optional<ArraySplit> split = SplitArray(pos_, end_, maxParts);
+				if (!split || split->parts.size() < 2) {
+					return nullopt;
+				}
+				return split;
+			}
+
+			// end of part of array: comma before next part or closing bracket
+			static const char* GetPartEnd(const ArraySplit& split, size_t part) {
+				return part + 1 < split.parts.size() ? split.parts[part + 1] - 1 : split.end;
+			}
+
+			void SkipSpaces() {
+				while (pos_ != end_ && IsSpace(*pos_)) {
+					++pos_;
+				}
+			}
+
+			// next char after spaces, it is consumed
+			char NextToken(const char* error) {
+				SkipSpaces();
+				if (pos_ == end_) {
+					throw ParsingError(error);
+				}
+				return *pos_++;
+			}
+
+			Node LoadScalar() {
+				switch (*pos_) {
+				case '"':
+					++pos_;
+					return Node(LoadString());
+				case 't':
+				case 'f':
+					return LoadBool();
+				case 'n':
+					return LoadNull();
+				default:
+					return LoadNumber();
+				}
+			}
+
+			Node LoadArray() {
+				++depth_;
+				Array result;
+				SkipSpaces();
+				if (pos_ != end_ && *pos_ == ']') {
+					++pos_;
+				}
+				else {
+					while (true) {
+						result.push_back(LoadNode());
+						const char ch = NextToken("Array Error!");
+						if (ch == ']') {
+							break;
+						}
+						if (ch != ',') {
+							throw ParsingError("Array Error!");
+						}
+					}
+				}
+				--depth_;
+				return Node(move(result));
+			}
+
+			// parts of array are parsed by separate parsers and joined in order
+			Node LoadArrayParallel() {
+				const optional<ArraySplit> split = SplitLargeArray();
+				if (!split) {
+					return LoadArray();
+				}
+				vector<Array> parts(split->parts.size());
+				RunParallel(parts.size(), [&split, &parts](size_t part) {
+					const char* const begin = split->parts[part];
+					Parser parser(string_view(begin, GetPartEnd(*split, part) - begin));
+					parser.LoadElements(parts[part], [&parser] { return parser.LoadNode(); });
+				});
+				size_t size = 0;
+				for (const Array& part : parts) {
+					size += part.size();
+				}
+				Array result;
+				result.reserve(size);
+				for (Array& part : parts) {
+					move(part.begin(), part.end(), back_inserter(result));
+				}
+				pos_ = split->end + 1;
+				return Node(move(result));
+			}
+
+			// opening quote is consumed already
+			string LoadString() {
+				const char* stop = FindQuoteOrEscape(pos_, end_);
+				// common case without escapes is copied at once
+				if (stop != end_ && *stop == '"') {
+					string line(pos_, stop);
+					pos_ = stop + 1;
+					return line;
+				}
+				string line;
+				while (true) {
+					line.append(pos_, stop);
+					pos_ = stop;
+					if (pos_ == end_) {
+						throw ParsingError("Unpaired quotes!");
+					}
+					if (*pos_++ == '"') {
+						return line;
+					}
+					if (pos_ == end_) {
+						throw ParsingError("Unpaired quotes!");
+					}
+					AppendEscaped(line, *pos_++);
+					stop = FindQuoteOrEscape(pos_, end_);
+				}
+			}
+
+			Node LoadDict() {
+				Dict result;
+				char ch = NextToken("Dict Error!");
+				if (ch == '}') {
+					return Node(move(result));
+				}
+				++depth_;
+				while (true) {
+					if (ch != '"') {
+						throw ParsingError("Dict Error!");
+					}
+					string key = LoadString();
+					if (NextToken("Dict Error!") != ':') {
+						throw ParsingError("Dict Error!");
+					}
+					Node value = LoadNode();
+					// the first of repeated keys is kept
+					result.emplace(move(key), move(value));
+					ch = NextToken("Dict Error!");
+					if (ch == '}') {
 						break;
 					}
-					case 'r': {
-						line.push_back('\r');
+					if (ch != ',') {
+						throw ParsingError("Dict Error!");
+					}
+					ch = NextToken("Dict Error!");
+				}
+				--depth_;
+				return Node(move(result));
+			}
+
+			void ParseArray(Handler& handler) {
+				handler.StartArray();
+				SkipSpaces();
+				if (pos_ != end_ && *pos_ == ']') {
+					++pos_;
+					handler.EndArray();
+					return;
+				}
+				while (true) {
+					Parse(handler);
+					const char ch = NextToken("Array Error!");
+					if (ch == ']') {
 						break;
 					}
-					case 't': {
-						line.push_back('\t');
+					if (ch != ',') {
+						throw ParsingError("Array Error!");
+					}
+				}
+				handler.EndArray();
+			}
+
+			void ParseDict(Handler& handler) {
+				handler.StartDict();
+				char ch = NextToken("Dict Error!");
+				while (ch != '}') {
+					if (ch != '"') {
+						throw ParsingError("Dict Error!");
+					}
+					handler.Key(LoadString());
+					if (NextToken("Dict Error!") != ':') {
+						throw ParsingError("Dict Error!");
+					}
+					Parse(handler);
+					ch = NextToken("Dict Error!");
+					if (ch == '}') {
 						break;
 					}
-					default:
-						throw ParsingError("invalid escape character!"s);
+					if (ch != ',') {
+						throw ParsingError("Dict Error!");
 					}
+					ch = NextToken("Dict Error!");
+				}
+				handler.EndDict();
+			}
+
+			string_view LoadWord() {
+				const char* begin = pos_;
+				while (pos_ != end_ && isalpha(static_cast<unsigned char>(*pos_))) {
+					++pos_;
+				}
+				return { begin, static_cast<size_t>(pos_ - begin) };
+			}
+
+			Node LoadBool() {
+				const string_view word = LoadWord();
+				if (word == "true"sv) {
+					return Node(true);
+				}
+				else if (word == "false"sv) {
+					return Node(false);
 				}
 				else {
-					line.push_back(ch);
+					throw ParsingError("Input is wrong"s);
 				}
 			}
-			if (numQoutes % 2 != 0) {
-				throw ParsingError("Unpaired quotes!");
+
+			Node LoadNull() {
+				if (LoadWord() == "null"sv) {
+					return Node();
+				}
+				else {
+					throw ParsingError("Input is wrong"s);
+				}
 			}
-			return Node(move(line));
-		}
 
-		Node LoadDict(istream& input) {
-			Dict result;
+			void SkipDigits() {
+				if (pos_ == end_ || !IsDigit(*pos_)) {
+					throw ParsingError("A digit is expected"s);
+				}
+				while (pos_ != end_ && IsDigit(*pos_)) {
+					++pos_;
+				}
+			}
 
-			for (char c; input >> c && c != '}';) {
-				if (c == ',') {
-					input >> c;
+			// grammar of number is checked here, conversion is left to from_chars
+			Node LoadNumber() {
+				const char* begin = pos_;
+				if (*pos_ == '-') {
+					++pos_;
+				}
+				// no other digits can follow leading 0
+				if (pos_ != end_ && *pos_ == '0') {
+					++pos_;
+				}
+				else {
+					SkipDigits();
 				}
 
-				string key = LoadString(input).AsString();
-				input >> c;
-				result.insert({ move(key), LoadNode(input) });
+				bool is_int = true;
+				if (pos_ != end_ && *pos_ == '.') {
+					++pos_;
+					SkipDigits();
+					is_int = false;
+				}
+				if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+					++pos_;
+					if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+						++pos_;
+					}
+					SkipDigits();
+					is_int = false;
+				}
+				return MakeNumber(begin, pos_, is_int);
 			}
-			if (!input) {
-				throw ParsingError("Dict Error!");
+		};
+
+		// the same grammar as Parser::Parse, but text is read from stream by blocks
+		// while it's parsed: only current block is kept, not the whole document
+		class StreamParser {
+		public:
+			explicit StreamParser(istream& input)
+				: input_(input.rdbuf()), block_(blockSize, '\0') {
+			}
+
+			void Parse(Handler& handler) {
+				SkipSpaces();
+				switch (Peek()) {
+				case '\0':
+					throw ParsingError("Input is empty"s);
+				case '[':
+					++pos_;
+					ParseArray(handler);
+					break;
+				case '{':
+					++pos_;
+					ParseDict(handler);
+					break;
+				default:
+					handler.Value(LoadScalar());
+				}
 			}
-			return Node(move(result));
-		}
 
-		Node LoadBool(istream& input) {
-			string str;
-			while (isalpha(input.peek())) {
-				str += input.get();
+		private:
+			static const size_t blockSize = 1 << 16;
+
+			streambuf* input_;
+			string block_;
+			const char* pos_ = nullptr;
+			const char* end_ = nullptr;
+			// text of number being read, it may lie in two blocks
+			string number_;
+
+			// false at end of stream, otherwise pos_ points to next char
+			bool Fill() {
+				if (pos_ != end_) {
+					return true;
+				}
+				if (input_ == nullptr || input_->sgetc() == char_traits<char>::eof()) {
+					return false;
+				}
+				// text already waiting in stream is taken without waiting for whole block
+				const streamsize available = input_->in_avail();
+				const streamsize size = input_->sgetn(block_.data(), available > 0
+					? min(available, static_cast<streamsize>(blockSize)) : static_cast<streamsize>(blockSize));
+				pos_ = block_.data();
+				end_ = pos_ + max<streamsize>(size, 0);
+				return pos_ != end_;
 			}
-			if (str == "true") {
-				return Node(true);
+
+			// next char which is not consumed, zero at end of stream
+			char Peek() {
+				return Fill() ? *pos_ : '\0';
 			}
-			else if (str == "false") {
-				return Node(false);
+
+			void SkipSpaces() {
+				while (Fill() && IsSpace(*pos_)) {
+					++pos_;
+				}
 			}
-			else {
-				throw ParsingError("Input is wrong"s);
+
+			// next char after spaces, it is consumed
+			char NextToken(const char* error) {
+				SkipSpaces();
+				if (!Fill()) {
+					throw ParsingError(error);
+				}
+				return *pos_++;
 			}
-		}
 
-		Node LoadNull(istream& input) {
-			string str;
-			while (isalpha(input.peek())) {
-				str += input.get();
+			Node LoadScalar() {
+				switch (Peek()) {
+				case '"':
+					++pos_;
+					return Node(LoadString());
+				case 't':
+				case 'f':
+					return LoadBool();
+				case 'n':
+					return LoadNull();
+				default:
+					return LoadNumber();
+				}
 			}
-			if (str == "null") {
-				return Node();
+
+			// opening quote is consumed already
+			string LoadString() {
+				string line;
+				while (true) {
+					if (!Fill()) {
+						throw ParsingError("Unpaired quotes!");
+					}
+					const char* stop = FindQuoteOrEscape(pos_, end_);
+					line.append(pos_, stop);
+					pos_ = stop;
+					if (pos_ == end_) {
+						continue;
+					}
+					if (*pos_++ == '"') {
+						return line;
+					}
+					if (!Fill()) {
+						throw ParsingError("Unpaired quotes!");
+					}
+					AppendEscaped(line, *pos_++);
+				}
 			}
-			else {
-				throw ParsingError("Input is wrong"s);
+
+			void ParseArray(Handler& handler) {
+				handler.StartArray();
+				SkipSpaces();
+				if (Peek() == ']') {
+					++pos_;
+					handler.EndArray();
+					return;
+				}
+				while (true) {
+					Parse(handler);
+					const char ch = NextToken("Array Error!");
+					if (ch == ']') {
+						break;
+					}
+					if (ch != ',') {
+						throw ParsingError("Array Error!");
+					}
+				}
+				handler.EndArray();
+			}
+
+			void ParseDict(Handler& handler) {
+				handler.StartDict();
+				char ch = NextToken("Dict Error!");
+				while (ch != '}') {
+					if (ch != '"') {
+						throw ParsingError("Dict Error!");
+					}
+					handler.Key(LoadString());
+					if (NextToken("Dict Error!") != ':') {
+						throw ParsingError("Dict Error!");
+					}
+					Parse(handler);
+					ch = NextToken("Dict Error!");
+					if (ch == '}') {
+						break;
+					}
+					if (ch != ',') {
+						throw ParsingError("Dict Error!");
+					}
+					ch = NextToken("Dict Error!");
+				}
+				handler.EndDict();
 			}
-		}
 
-		Node LoadNumber(std::istream& input) {
-			using namespace std::literals;
+			string LoadWord() {
+				string word;
+				while (Fill() && isalpha(static_cast<unsigned char>(*pos_))) {
+					word.push_back(*pos_++);
+				}
+				return word;
+			}
 
-			std::string parsed_num;
+			Node LoadBool() {
+				const string word = LoadWord();
+				if (word == "true"sv) {
+					return Node(true);
+				}
+				else if (word == "false"sv) {
+					return Node(false);
+				}
+				else {
+					throw ParsingError("Input is wrong"s);
+				}
+			}
 
-			//   parsed_num    input
-			auto read_char = [&parsed_num, &input] {
-				parsed_num += static_cast<char>(input.get());
-				if (!input) {
-					throw ParsingError("Failed to read number from stream"s);
+			Node LoadNull() {
+				if (LoadWord() == "null"sv) {
+					return Node();
 				}
-			};
+				else {
+					throw ParsingError("Input is wrong"s);
+				}
+			}
 
-			//       parsed_num  input
-			auto read_digits = [&input, read_char] {
-				if (!std::isdigit(input.peek())) {
+			void TakeDigits() {
+				if (!IsDigit(Peek())) {
 					throw ParsingError("A digit is expected"s);
 				}
-				while (std::isdigit(input.peek())) {
-					read_char();
+				while (IsDigit(Peek())) {
+					number_.push_back(*pos_++);
 				}
-			};
+			}
 
-			if (input.peek() == '-') {
-				read_char();
+			// the same grammar as Parser::LoadNumber, text is collected in number_
+			Node LoadNumber() {
+				number_.clear();
+				if (Peek() == '-') {
+					number_.push_back(*pos_++);
+				}
+				// no other digits can follow leading 0
+				if (Peek() == '0') {
+					number_.push_back(*pos_++);
+				}
+				else {
+					TakeDigits();
+				}
+
+				bool is_int = true;
+				if (Peek() == '.') {
+					number_.push_back(*pos_++);
+					TakeDigits();
+					is_int = false;
+				}
+				if (Peek() == 'e' || Peek() == 'E') {
+					number_.push_back(*pos_++);
+					if (Peek() == '+' || Peek() == '-') {
+						number_.push_back(*pos_++);
+					}
+					TakeDigits();
+					is_int = false;
+				}
+				return MakeNumber(number_.data(), number_.data() + number_.size(), is_int);
 			}
-			//    
-			if (input.peek() == '0') {
-				read_char();
-				//  0  JSON     
+		};
+
+		// dicts up to this size are sorted in place
+		const ptrdiff_t smallDict = 16;
+
+		// builds arena document: children of container are collected on stacks and
+		// moved to pool together when container is closed, so they lie side by side
+		class ArenaParser : private Parser {
+		public:
+			ArenaParser(string& text, vector<detail::ArenaItem>& items, vector<detail::ArenaMember>& members,
+				size_t threads = 1)
+				: Parser(text, threads), begin_(text.data()), data_(text.data()), items_(items), members_(members) {
 			}
-			else {
-				read_digits();
+
+			detail::ArenaItem ParseRoot() {
+				return ParseItem();
 			}
 
-			bool is_int = true;
-			//    
-			if (input.peek() == '.') {
-				read_char();
-				read_digits();
-				is_int = false;
+			// value in [begin, end) of text
+			detail::ArenaItem ParseRoot(size_t begin, size_t end) {
+				pos_ = begin_ + begin;
+				end_ = begin_ + end;
+				return ParseItem();
 			}
 
-			//    
-			if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-				read_char();
-				if (ch = input.peek(); ch == '+' || ch == '-') {
-					read_char();
-				}
-				read_digits();
-				is_int = false;
+		private:
+			// elements of part of array with their own pools
+			struct ArenaPart {
+				vector<detail::ArenaItem> items;
+				vector<detail::ArenaMember> members;
+				vector<detail::ArenaItem> elements;
+			};
+
+			const char* begin_;
+			char* data_;
+			vector<detail::ArenaItem>& items_;
+			vector<detail::ArenaMember>& members_;
+			vector<detail::ArenaItem> itemStack_;
+			vector<detail::ArenaMember> memberStack_;
+
+			uint32_t GetOffset(const char* pos) const {
+				return static_cast<uint32_t>(pos - begin_);
 			}
 
-			try {
-				if (is_int) {
-					//      int
-					try {
-						return Node(std::stoi(parsed_num));
-					}
-					catch (...) {
-						//   , ,  ,
-						//       double
+			detail::ArenaItem ParseItem() {
+				SkipSpaces();
+				if (pos_ == end_) {
+					throw ParsingError("Input is empty"s);
+				}
+				detail::ArenaItem item{};
+				switch (*pos_) {
+				case '[':
+					++pos_;
+					if (threads_ > 1 && depth_ < parallelDepth) {
+						return ParseArrayParallel();
 					}
+					return ParseArray();
+				case '{':
+					++pos_;
+					return ParseDict();
+				case '"': {
+					++pos_;
+					const string_view str = LoadStringInPlace();
+					item.type = detail::ArenaType::String;
+					item.size = static_cast<uint32_t>(str.size());
+					item.offset = GetOffset(str.data());
+					return item;
+				}
+				default:
+					break;
+				}
+				const Node scalar = LoadScalar();
+				if (scalar.IsBool()) {
+					item.type = detail::ArenaType::Bool;
+					item.boolean = scalar.AsBool();
+				}
+				else if (scalar.IsInt()) {
+					item.type = detail::ArenaType::Int;
+					item.integer = scalar.AsInt();
+				}
+				else if (scalar.IsPureDouble()) {
+					item.type = detail::ArenaType::Double;
+					item.number = scalar.AsDouble();
 				}
-				return Node(std::stod(parsed_num));
+				return item;
 			}
-			catch (...) {
-				throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+
+			detail::ArenaItem ParseArray() {
+				++depth_;
+				const size_t mark = itemStack_.size();
+				SkipSpaces();
+				if (pos_ != end_ && *pos_ == ']') {
+					++pos_;
+				}
+				else {
+					while (true) {
+						const detail::ArenaItem element = ParseItem();
+						itemStack_.push_back(element);
+						const char ch = NextToken("Array Error!");
+						if (ch == ']') {
+							break;
+						}
+						if (ch != ',') {
+							throw ParsingError("Array Error!");
+						}
+					}
+				}
+				--depth_;
+				return CloseArray(mark);
 			}
-		}
 
-		Node LoadNode(istream& input) {
-			char ch;
-			if (!(input >> ch)) {
-				throw ParsingError("Input is empty"s);
+			// elements from mark to top of stack are moved to pool
+			detail::ArenaItem CloseArray(size_t mark) {
+				detail::ArenaItem item{};
+				item.type = detail::ArenaType::Array;
+				item.size = static_cast<uint32_t>(itemStack_.size() - mark);
+				item.offset = static_cast<uint32_t>(items_.size());
+				items_.insert(items_.end(), itemStack_.begin() + mark, itemStack_.end());
+				itemStack_.resize(mark);
+				return item;
 			}
-			else if (ch == '[') {
-				return LoadArray(input);
+
+			// parts of array are parsed into separate pools, then pools are appended
+			// in order with shifted offsets, so result is the same as of ParseArray
+			detail::ArenaItem ParseArrayParallel() {
+				const optional<ArraySplit> split = SplitLargeArray();
+				if (!split) {
+					return ParseArray();
+				}
+				vector<ArenaPart> parts(split->parts.size());
+				RunParallel(parts.size(), [this, &split, &parts](size_t part) {
+					ArenaParser parser(*this, parts[part]);
+					parser.pos_ = split->parts[part];
+					parser.end_ = GetPartEnd(*split, part);
+					parser.LoadElements(parts[part].elements, [&parser] { return parser.ParseItem(); });
+				});
+
+				const size_t mark = itemStack_.size();
+				for (ArenaPart& part : parts) {
+					const uint32_t itemShift = static_cast<uint32_t>(items_.size());
+					const uint32_t memberShift = static_cast<uint32_t>(members_.size());
+					auto shift = [itemShift, memberShift](detail::ArenaItem item) {
+						if (item.type == detail::ArenaType::Array) {
+							item.offset += itemShift;
+						}
+						else if (item.type == detail::ArenaType::Dict) {
+							item.offset += memberShift;
+						}
+						return item;
+					};
+					for (const detail::ArenaItem& item : part.items) {
+						items_.push_back(shift(item));
+					}
+					for (detail::ArenaMember member : part.members) {
+						member.value = shift(member.value);
+						members_.push_back(member);
+					}
+					for (const detail::ArenaItem& element : part.elements) {
+						itemStack_.push_back(shift(element));
+					}
+					part = ArenaPart{};
+				}
+				pos_ = split->end + 1;
+				return CloseArray(mark);
 			}
-			else if (ch == '{') {
-				return LoadDict(input);
+
+			// parser of one part of array, it shares text with parent
+			ArenaParser(const ArenaParser& parent, ArenaPart& part)
+				: Parser(string_view{}), begin_(parent.begin_), data_(parent.data_),
+				items_(part.items), members_(part.members) {
 			}
-			else if (ch == '"') {
-				return LoadString(input);
+
+			detail::ArenaItem ParseDict() {
+				++depth_;
+				const size_t mark = memberStack_.size();
+				char ch = NextToken("Dict Error!");
+				while (ch != '}') {
+					if (ch != '"') {
+						throw ParsingError("Dict Error!");
+					}
+					const string_view key = LoadStringInPlace();
+					if (NextToken("Dict Error!") != ':') {
+						throw ParsingError("Dict Error!");
+					}
+					const detail::ArenaItem value = ParseItem();
+					memberStack_.push_back({ GetOffset(key.data()), static_cast<uint32_t>(key.size()), value });
+					ch = NextToken("Dict Error!");
+					if (ch == '}') {
+						break;
+					}
+					if (ch != ',') {
+						throw ParsingError("Dict Error!");
+					}
+					ch = NextToken("Dict Error!");
+				}
+				--depth_;
+
+				// sorted by key for binary search, the first of repeated keys is kept
+				auto key = [this](const detail::ArenaMember& member) {
+					return string_view(begin_ + member.keyOffset, member.keySize);
+				};
+				const auto first = memberStack_.begin() + mark;
+				if (memberStack_.end() - first <= smallDict) {
+					// insertion sort is stable and needs no buffer unlike stable_sort
+					for (auto it = first; it != memberStack_.end(); ++it) {
+						const detail::ArenaMember member = *it;
+						auto hole = it;
+						for (; hole != first && key(member) < key(*(hole - 1)); --hole) {
+							*hole = *(hole - 1);
+						}
+						*hole = member;
+					}
+				}
+				else {
+					stable_sort(first, memberStack_.end(), [&key](const auto& lhs, const auto& rhs) {
+						return key(lhs) < key(rhs);
+					});
+				}
+				const auto last = unique(first, memberStack_.end(), [&key](const auto& lhs, const auto& rhs) {
+					return key(lhs) == key(rhs);
+				});
+
+				detail::ArenaItem item{};
+				item.type = detail::ArenaType::Dict;
+				item.size = static_cast<uint32_t>(last - first);
+				item.offset = static_cast<uint32_t>(members_.size());
+				members_.insert(members_.end(), first, last);
+				memberStack_.resize(mark);
+				return item;
 			}
-			else if (ch == 't' || ch == 'f') {
-				input.putback(ch);
-				return LoadBool(input);
+
+			// escaped string is shortened in place, opening quote is consumed already
+			string_view LoadStringInPlace() {
+				const char* stop = FindQuoteOrEscape(pos_, end_);
+				if (stop != end_ && *stop == '"') {
+					const string_view str(pos_, stop - pos_);
+					pos_ = stop + 1;
+					return str;
+				}
+				char* const first = data_ + GetOffset(pos_);
+				char* out = first;
+				while (true) {
+					const size_t size = stop - pos_;
+					memmove(out, data_ + GetOffset(pos_), size);
+					out += size;
+					pos_ = stop;
+					if (pos_ == end_) {
+						throw ParsingError("Unpaired quotes!");
+					}
+					if (*pos_++ == '"') {
+						return { first, static_cast<size_t>(out - first) };
+					}
+					if (pos_ == end_) {
+						throw ParsingError("Unpaired quotes!");
+					}
+					switch (*pos_++) {
+					case '"':
+						*out++ = '"';
+						break;
+					case '\\':
+						*out++ = '\\';
+						break;
+					case 'n':
+						*out++ = '\n';
+						break;
+					case 'r':
+						*out++ = '\r';
+						break;
+					case 't':
+						*out++ = '\t';
+						break;
+					default:
+						throw ParsingError("invalid escape character!"s);
+					}
+					stop = FindQuoteOrEscape(pos_, end_);
+				}
 			}
-			else if (ch == 'n') {
-				input.putback(ch);
-				return LoadNull(input);
+		};
+
+		// bounds of values of root dict, containers are only scanned for their end
+		class SectionScanner : private Parser {
+		public:
+			using Parser::Parser;
+
+			// onSection(key, begin, end) is called for each member of root
+			template <typename OnSection>
+			void Scan(OnSection onSection) {
+				if (NextToken("Input is empty") != '{') {
+					throw ParsingError("Root of document is not dict"s);
+				}
+				char ch = NextToken("Dict Error!");
+				while (ch != '}') {
+					if (ch != '"') {
+						throw ParsingError("Dict Error!");
+					}
+					string key = LoadString();
+					if (NextToken("Dict Error!") != ':') {
+						throw ParsingError("Dict Error!");
+					}
+					SkipSpaces();
+					const char* begin = pos_;
+					SkipValue();
+					onSection(move(key), begin, pos_);
+					ch = NextToken("Dict Error!");
+					if (ch == '}') {
+						break;
+					}
+					if (ch != ',') {
+						throw ParsingError("Dict Error!");
+					}
+					ch = NextToken("Dict Error!");
+				}
 			}
-			else {
-				input.putback(ch);
-				return LoadNumber(input);
+
+		private:
+			void SkipValue() {
+				if (pos_ == end_) {
+					throw ParsingError("Input is empty"s);
+				}
+				if (*pos_ != '[' && *pos_ != '{') {
+					LoadScalar();
+					return;
+				}
+				const char* close = FindClose(pos_ + 1, end_, [](const char*) {});
+				if (close == nullptr) {
+					throw ParsingError(*pos_ == '[' ? "Array Error!" : "Dict Error!");
+				}
+				pos_ = close + 1;
 			}
-		}
+		};
 
 	}  // namespace
 
+	string ReadAll(istream& input) {
+		string text;
+		streambuf* buffer = input.rdbuf();
+		if (buffer == nullptr) {
+			return text;
+		}
+		size_t size = 0;
+		text.resize(1 << 16);
+		while (true) {
+			size += static_cast<size_t>(buffer->sgetn(text.data() + size,
+				static_cast<streamsize>(text.size() - size)));
+			if (size < text.size()) {
+				break;
+			}
+			text.resize(text.size() * 2);
+		}
+		text.resize(size);
+		return text;
+	}
+
 	/*************************Print operators********************/
 
 	void OstreamJSONPrinter::operator()(std::nullptr_t) const
@@ -279,13 +1287,18 @@ namespace json {
 
 	void OstreamJSONPrinter::operator()(const double value) const
 	{
-		out << value;
+		format::WriteDouble(out, value);
 	}
 
 	void OstreamJSONPrinter::operator()(const std::string value) const
+	{
+		PrintString(value, out);
+	}
+
+	void PrintString(std::string_view str, std::ostream& out)
 	{
 		out << "\""s;
-		for (const auto ch : value) {
+		for (const auto ch : str) {
 			switch (ch) {
 			case '"': {
 				out << '\\' << '\"';
@@ -487,8 +1500,21 @@ namespace json {
 		return !(root_ == rhs.GetRoot());
 	}
 
-	Document Load(istream& input) {
-		return Document{ LoadNode(input) };
+	Document Load(istream& input, size_t threads) {
+		const string text = ReadAll(input);
+		return Load(text, threads);
+	}
+
+	Document Load(string_view text, size_t threads) {
+		return Document{ Parser(text, threads).LoadNode() };
+	}
+
+	void Parse(istream& input, Handler& handler) {
+		StreamParser(input).Parse(handler);
+	}
+
+	void Parse(string_view text, Handler& handler) {
+		Parser(text).Parse(handler);
 	}
 
 	void Print(const Document& doc, std::ostream& output)
@@ -500,4 +1526,294 @@ namespace json {
 	{
 		std::visit(OstreamJSONPrinter{ output }, node.GetData());
 	}
+
+	/********************Arena document*************************/
+
+	NodeView::NodeView(const ArenaDocument& doc, const detail::ArenaItem& item)
+		: doc_(&doc), item_(&item) {
+	}
+
+	bool NodeView::IsNull() const {
+		return item_->type == detail::ArenaType::Null;
+	}
+
+	bool NodeView::IsArray() const {
+		return item_->type == detail::ArenaType::Array;
+	}
+
+	bool NodeView::IsDict() const {
+		return item_->type == detail::ArenaType::Dict;
+	}
+
+	bool NodeView::IsBool() const {
+		return item_->type == detail::ArenaType::Bool;
+	}
+
+	bool NodeView::IsInt() const {
+		return item_->type == detail::ArenaType::Int;
+	}
+
+	bool NodeView::IsDouble() const {
+		return IsInt() || IsPureDouble();
+	}
+
+	bool NodeView::IsPureDouble() const {
+		return item_->type == detail::ArenaType::Double;
+	}
+
+	bool NodeView::IsString() const {
+		return item_->type == detail::ArenaType::String;
+	}
+
+	ArrayView NodeView::AsArray() const {
+		if (!IsArray()) {
+			throw logic_error("Type is not Array"s);
+		}
+		return ArrayView(*doc_, doc_->items_.data() + item_->offset, item_->size);
+	}
+
+	DictView NodeView::AsDict() const {
+		if (!IsDict()) {
+			throw logic_error("Type is not Dict"s);
+		}
+		return DictView(*doc_, doc_->members_.data() + item_->offset, item_->size);
+	}
+
+	bool NodeView::AsBool() const {
+		if (!IsBool()) {
+			throw logic_error("Type is not bool"s);
+		}
+		return item_->boolean;
+	}
+
+	int NodeView::AsInt() const {
+		if (!IsInt()) {
+			throw logic_error("Type is not int"s);
+		}
+		return item_->integer;
+	}
+
+	double NodeView::AsDouble() const {
+		if (IsPureDouble()) {
+			return item_->number;
+		}
+		else if (IsInt()) {
+			return item_->integer;
+		}
+		else {
+			throw logic_error("Type is not double"s);
+		}
+	}
+
+	string_view NodeView::AsString() const {
+		if (!IsString()) {
+			throw logic_error("Type is not string"s);
+		}
+		return doc_->GetString(item_->offset, item_->size);
+	}
+
+	Node NodeView::ToNode() const {
+		switch (item_->type) {
+		case detail::ArenaType::Array: {
+			Array result;
+			result.reserve(item_->size);
+			for (const NodeView element : AsArray()) {
+				result.push_back(element.ToNode());
+			}
+			return Node(move(result));
+		}
+		case detail::ArenaType::Dict: {
+			Dict result;
+			for (const auto& [key, value] : AsDict()) {
+				result.emplace_hint(result.end(), string(key), value.ToNode());
+			}
+			return Node(move(result));
+		}
+		case detail::ArenaType::Bool:
+			return Node(item_->boolean);
+		case detail::ArenaType::Int:
+			return Node(item_->integer);
+		case detail::ArenaType::Double:
+			return Node(item_->number);
+		case detail::ArenaType::String:
+			return Node(string(AsString()));
+		default:
+			return Node();
+		}
+	}
+
+	ArrayView::Iterator::Iterator(const ArenaDocument& doc, const detail::ArenaItem* item)
+		: doc_(&doc), item_(item) {
+	}
+
+	NodeView ArrayView::Iterator::operator*() const {
+		return NodeView(*doc_, *item_);
+	}
+
+	ArrayView::Iterator& ArrayView::Iterator::operator++() {
+		++item_;
+		return *this;
+	}
+
+	bool ArrayView::Iterator::operator==(const Iterator& other) const {
+		return item_ == other.item_;
+	}
+
+	bool ArrayView::Iterator::operator!=(const Iterator& other) const {
+		return item_ != other.item_;
+	}
+
+	ArrayView::ArrayView(const ArenaDocument& doc, const detail::ArenaItem* begin, size_t size)
+		: doc_(&doc), begin_(begin), size_(size) {
+	}
+
+	size_t ArrayView::size() const {
+		return size_;
+	}
+
+	bool ArrayView::empty() const {
+		return size_ == 0;
+	}
+
+	NodeView ArrayView::operator[](size_t index) const {
+		return NodeView(*doc_, begin_[index]);
+	}
+
+	ArrayView::Iterator ArrayView::begin() const {
+		return Iterator(*doc_, begin_);
+	}
+
+	ArrayView::Iterator ArrayView::end() const {
+		return Iterator(*doc_, begin_ + size_);
+	}
+
+	DictView::Iterator::Iterator(const ArenaDocument& doc, const detail::ArenaMember* member)
+		: doc_(&doc), member_(member) {
+	}
+
+	pair<string_view, NodeView> DictView::Iterator::operator*() const {
+		return { doc_->GetString(member_->keyOffset, member_->keySize), NodeView(*doc_, member_->value) };
+	}
+
+	DictView::Iterator& DictView::Iterator::operator++() {
+		++member_;
+		return *this;
+	}
+
+	bool DictView::Iterator::operator==(const Iterator& other) const {
+		return member_ == other.member_;
+	}
+
+	bool DictView::Iterator::operator!=(const Iterator& other) const {
+		return member_ != other.member_;
+	}
+
+	DictView::DictView(const ArenaDocument& doc, const detail::ArenaMember* begin, size_t size)
+		: doc_(&doc), begin_(begin), size_(size) {
+	}
+
+	size_t DictView::size() const {
+		return size_;
+	}
+
+	bool DictView::empty() const {
+		return size_ == 0;
+	}
+
+	size_t DictView::count(string_view key) const {
+		return Find(key) != nullptr ? 1 : 0;
+	}
+
+	NodeView DictView::at(string_view key) const {
+		const detail::ArenaMember* member = Find(key);
+		if (member == nullptr) {
+			throw out_of_range("No key "s + string(key));
+		}
+		return NodeView(*doc_, member->value);
+	}
+
+	DictView::Iterator DictView::begin() const {
+		return Iterator(*doc_, begin_);
+	}
+
+	DictView::Iterator DictView::end() const {
+		return Iterator(*doc_, begin_ + size_);
+	}
+
+	const detail::ArenaMember* DictView::Find(string_view key) const {
+		const detail::ArenaMember* end = begin_ + size_;
+		const detail::ArenaMember* it = lower_bound(begin_, end, key,
+			[this](const detail::ArenaMember& member, string_view key) {
+				return doc_->GetString(member.keyOffset, member.keySize) < key;
+			});
+		if (it == end || doc_->GetString(it->keyOffset, it->keySize) != key) {
+			return nullptr;
+		}
+		return it;
+	}
+
+	ArenaDocument::ArenaDocument(istream& input, size_t threads) {
+		Load(ReadAll(input), threads);
+	}
+
+	ArenaDocument::ArenaDocument(string text, size_t threads) {
+		Load(move(text), threads);
+	}
+
+	ArenaDocument::ArenaDocument(shared_ptr<string> text, size_t begin, size_t end, size_t threads)
+		: text_(move(text)) {
+		root_ = ArenaParser(*text_, items_, members_, threads).ParseRoot(begin, end);
+	}
+
+	void ArenaDocument::Load(string text, size_t threads) {
+		Clear();
+		text_ = make_shared<string>(move(text));
+		root_ = ArenaParser(*text_, items_, members_, threads).ParseRoot();
+	}
+
+	void ArenaDocument::Clear() {
+		text_.reset();
+		items_.clear();
+		members_.clear();
+		root_ = detail::ArenaItem{};
+	}
+
+	NodeView ArenaDocument::GetRoot() const {
+		return NodeView(*this, root_);
+	}
+
+	string_view ArenaDocument::GetString(uint32_t offset, uint32_t size) const {
+		return { text_->data() + offset, size };
+	}
+
+	/*************************Lazy document**********************/
+
+	LazyDocument::LazyDocument(istream& input, size_t threads)
+		: LazyDocument(ReadAll(input), threads) {
+	}
+
+	LazyDocument::LazyDocument(string text, size_t threads)
+		: text_(make_shared<string>(move(text))), threads_(threads) {
+		const char* const begin = text_->data();
+		SectionScanner(*text_).Scan([this, begin](string key, const char* first, const char* last) {
+			sections_.emplace(move(key), Section{ static_cast<size_t>(first - begin),
+				static_cast<size_t>(last - begin), nullopt });
+		});
+	}
+
+	bool LazyDocument::Contains(string_view key) const {
+		return sections_.find(key) != sections_.end();
+	}
+
+	NodeView LazyDocument::Get(string_view key) {
+		const auto it = sections_.find(key);
+		if (it == sections_.end()) {
+			throw out_of_range("No section "s + string(key));
+		}
+		Section& section = it->second;
+		if (!section.doc) {
+			section.doc.emplace(text_, section.begin, section.end, threads_);
+		}
+		return section.doc->GetRoot();
+	}
 }  // namespace json
\ No newline at end of file
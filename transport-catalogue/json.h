@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 
@@ -84,9 +88,227 @@ namespace json {
 		Node root_;
 	};
 
-	Document Load(std::istream& input);
+	// the rest of stream read into one buffer by large blocks
+	std::string ReadAll(std::istream& input);
+
+	// reads the rest of stream and parses it as one buffer. Large arrays of root
+	// and of its members are cut between elements and parsed by up to threads
+	// threads, the document is the same as parsed by one thread
+	Document Load(std::istream& input, std::size_t threads = 1);
+	Document Load(std::string_view text, std::size_t threads = 1);
+
+	// receives parts of document in order of text instead of whole tree
+	class Handler {
+	public:
+		virtual ~Handler() = default;
+
+		virtual void StartDict() = 0;
+		virtual void Key(std::string key) = 0;
+		virtual void EndDict() = 0;
+		virtual void StartArray() = 0;
+		virtual void EndArray() = 0;
+		// null, bool, number or string
+		virtual void Value(Node value) = 0;
+	};
+
+	// stream is read by blocks of fixed size while it's parsed, so memory doesn't
+	// depend on size of document, only on parts kept by handler
+	void Parse(std::istream& input, Handler& handler);
+	void Parse(std::string_view text, Handler& handler);
+
+	/*************************Arena document*********************/
+
+	namespace detail {
+		enum class ArenaType : std::uint8_t { Null, Array, Dict, Bool, Int, Double, String };
+
+		// node of arena, elements of array and members of dict lie one after
+		// another in pool of document starting at offset
+		struct ArenaItem {
+			ArenaType type = ArenaType::Null;
+			// length of string, number of elements or members
+			std::uint32_t size = 0;
+			union {
+				bool boolean;
+				int integer;
+				double number;
+				// position of string in text or of first element or member in pool
+				std::uint32_t offset;
+			};
+		};
+
+		struct ArenaMember {
+			std::uint32_t keyOffset = 0;
+			std::uint32_t keySize = 0;
+			ArenaItem value;
+		};
+	}
+
+	class ArenaDocument;
+	class ArrayView;
+	class DictView;
+
+	// view of node of arena document, valid while document is alive and not changed
+	class NodeView {
+	public:
+		bool IsNull() const;
+		bool IsArray() const;
+		bool IsDict() const;
+		bool IsBool() const;
+		bool IsInt() const;
+		bool IsDouble() const;
+		bool IsPureDouble() const;
+		bool IsString() const;
+
+		ArrayView AsArray() const;
+		DictView AsDict() const;
+		bool AsBool() const;
+		int AsInt() const;
+		double AsDouble() const;
+		std::string_view AsString() const;
+
+		// copy of subtree as usual node
+		Node ToNode() const;
+
+	private:
+		friend class ArenaDocument;
+		friend class ArrayView;
+		friend class DictView;
+
+		NodeView(const ArenaDocument& doc, const detail::ArenaItem& item);
+
+		const ArenaDocument* doc_;
+		const detail::ArenaItem* item_;
+	};
+
+	class ArrayView {
+	public:
+		class Iterator {
+		public:
+			NodeView operator*() const;
+			Iterator& operator++();
+			bool operator==(const Iterator& other) const;
+			bool operator!=(const Iterator& other) const;
+
+		private:
+			friend class ArrayView;
+			Iterator(const ArenaDocument& doc, const detail::ArenaItem* item);
+
+			const ArenaDocument* doc_;
+			const detail::ArenaItem* item_;
+		};
+
+		std::size_t size() const;
+		bool empty() const;
+		NodeView operator[](std::size_t index) const;
+		Iterator begin() const;
+		Iterator end() const;
+
+	private:
+		friend class NodeView;
+		ArrayView(const ArenaDocument& doc, const detail::ArenaItem* begin, std::size_t size);
+
+		const ArenaDocument* doc_;
+		const detail::ArenaItem* begin_;
+		std::size_t size_;
+	};
+
+	// members are sorted by key, so dict is iterated in the same order as Dict
+	class DictView {
+	public:
+		class Iterator {
+		public:
+			std::pair<std::string_view, NodeView> operator*() const;
+			Iterator& operator++();
+			bool operator==(const Iterator& other) const;
+			bool operator!=(const Iterator& other) const;
+
+		private:
+			friend class DictView;
+			Iterator(const ArenaDocument& doc, const detail::ArenaMember* member);
+
+			const ArenaDocument* doc_;
+			const detail::ArenaMember* member_;
+		};
+
+		std::size_t size() const;
+		bool empty() const;
+		std::size_t count(std::string_view key) const;
+		// throws std::out_of_range if there is no key, like Dict
+		NodeView at(std::string_view key) const;
+		Iterator begin() const;
+		Iterator end() const;
+
+	private:
+		friend class NodeView;
+		DictView(const ArenaDocument& doc, const detail::ArenaMember* begin, std::size_t size);
+
+		const detail::ArenaMember* Find(std::string_view key) const;
+
+		const ArenaDocument* doc_;
+		const detail::ArenaMember* begin_;
+		std::size_t size_;
+	};
+
+	// document kept in a few flat pools instead of tree of separate allocations:
+	// strings are parts of input text unescaped in place, nodes and members are
+	// items of two vectors. Destroying or clearing it frees everything at once
+	class ArenaDocument {
+	public:
+		ArenaDocument() = default;
+		// threads are used for large arrays the same way as by json::Load
+		explicit ArenaDocument(std::istream& input, std::size_t threads = 1);
+		explicit ArenaDocument(std::string text, std::size_t threads = 1);
+		// value in [begin, end) of text shared with other documents, strings
+		// are unescaped in place, so values of documents must not overlap
+		ArenaDocument(std::shared_ptr<std::string> text, std::size_t begin, std::size_t end,
+			std::size_t threads = 1);
+
+		// replace document by new one, memory of pools is reused
+		void Load(std::string text, std::size_t threads = 1);
+		void Clear();
+
+		NodeView GetRoot() const;
+
+	private:
+		friend class NodeView;
+		friend class ArrayView;
+		friend class DictView;
+
+		std::shared_ptr<std::string> text_;
+		std::vector<detail::ArenaItem> items_;
+		std::vector<detail::ArenaMember> members_;
+		detail::ArenaItem root_{};
+
+		std::string_view GetString(std::uint32_t offset, std::uint32_t size) const;
+	};
+
+	// root dict whose sections are parsed when they are accessed first time,
+	// the rest of text is only scanned for bounds of sections
+	class LazyDocument {
+	public:
+		// threads are used to parse sections the same way as by ArenaDocument
+		explicit LazyDocument(std::istream& input, std::size_t threads = 1);
+		explicit LazyDocument(std::string text, std::size_t threads = 1);
+
+		bool Contains(std::string_view key) const;
+		// throws std::out_of_range if there is no section, like Dict
+		NodeView Get(std::string_view key);
+
+	private:
+		struct Section {
+			std::size_t begin = 0;
+			std::size_t end = 0;
+			std::optional<ArenaDocument> doc;
+		};
+
+		std::shared_ptr<std::string> text_;
+		std::size_t threads_;
+		// the first of repeated keys is kept
+		std::map<std::string, Section, std::less<>> sections_;
+	};
 
 	void Print(const Document& doc, std::ostream& output);
 	void PrintNode(const Node& node, std::ostream& output);
+	void PrintString(std::string_view str, std::ostream& output);
 	
 }  // namespace json
\ No newline at end of file
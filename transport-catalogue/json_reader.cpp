@@ -1,18 +1,32 @@
 #include "json_reader.h"
+#include "binary_input.h"
 #include "json_builder.h"
+#include "json_schema.h"
+#include "json_writer.h"
 #include "map_renderer.h"
+#include "profile.h"
 
 #include <algorithm> 
+#include <atomic>
+#include <bitset>
 #include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <exception>
+#include <limits>
 #include <locale>
+#include <map>
+#include <mutex>
 #include <queue>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <tuple>
 #include <string_view>
 #include <unordered_map>
 #include <optional>
+#include <thread>
 
 namespace reader
 {
@@ -23,6 +37,7 @@ namespace reader
 	static const std::string statReq{ "stat_requests"s };
 	static const std::string routeSet{ "routing_settings"s };
 	static const std::string serialSet{ "serialization_settings"s };
+	static const std::string updateReq{ "update_requests"s };
 	static const std::string type{ "type"s };
 	static const std::string name{ "name"s };
 	static const std::string stops{ "stops"s };
@@ -30,11 +45,132 @@ namespace reader
 	static const std::string lat{ "latitude"s };
 	static const std::string lng{ "longitude"s };
 	static const std::string dist{ "road_distances"s };
-	static const std::string id{ "id"s };
-	static const std::string velocity{ "bus_velocity"s };
-	static const std::string time{ "bus_wait_time"s };
-	static const std::string from{ "from"s };
-	static const std::string to{ "to"s };
+	static const std::string removed{ "removed"s };
+	// requests answered by one thread at once, their answers are kept together
+	static const std::size_t requestsPerChunk = 256;
+	// chunks of batch per thread, threads which take fast chunks take more of them
+	static const std::size_t chunksPerThread = 8;
+
+	/******************************Schemas********************************/
+	namespace {
+		template <typename NodeT>
+		bool DecodeColor(const NodeT& node, svg::Color& color) {
+			// define color by one word? like "green" or "red"
+			if (node.IsString()) {
+				color = std::string(node.AsString());
+				return true;
+			}
+			if (!node.IsArray()) {
+				return false;
+			}
+			const auto& arr = node.AsArray();
+			// define which type of RGB 
+			if (arr.size() == 3) {
+				color = svg::Rgb{ static_cast<std::uint8_t>(arr[0].AsInt()),
+					static_cast<std::uint8_t>(arr[1].AsInt()), static_cast<std::uint8_t>(arr[2].AsInt()) };
+				return true;
+			}
+			// or RGBa
+			if (arr.size() == 4) {
+				color = svg::Rgba{ static_cast<std::uint8_t>(arr[0].AsInt()),
+					static_cast<std::uint8_t>(arr[1].AsInt()), static_cast<std::uint8_t>(arr[2].AsInt()),
+					arr[3].AsDouble() };
+				return true;
+			}
+			return false;
+		}
+
+		template <typename NodeT>
+		void DecodeUnderlayerColor(const NodeT& node, renderer::Settings& setup) {
+			DecodeColor(node, setup.underlayer_color);
+		}
+
+		template <typename NodeT>
+		void DecodePalette(const NodeT& node, renderer::Settings& setup) {
+			if (!node.IsArray()) {
+				return;
+			}
+			for (const auto& element : node.AsArray()) {
+				svg::Color color;
+				if (DecodeColor(element, color)) {
+					setup.color_palette.push_back(std::move(color));
+				}
+			}
+		}
+
+		// keys of all kinds of stat requests, each kind uses part of them
+		template <typename NodeT>
+		constexpr json::Schema<detail::Query, NodeT, 11> querySchema{ {
+			json::MakeField<NodeT, &detail::Query::from>("from"sv),
+			json::MakeField<NodeT, &detail::Query::id_query>("id"sv),
+			json::MakeField<NodeT, &detail::Query::latitude>("latitude"sv),
+			json::MakeField<NodeT, &detail::Query::limit>("limit"sv),
+			json::MakeField<NodeT, &detail::Query::longitude>("longitude"sv),
+			json::MakeField<NodeT, &detail::Query::maxEdits>("max_edits"sv),
+			json::MakeField<NodeT, &detail::Query::nameStop>("name"sv),
+			json::MakeField<NodeT, &detail::Query::text>("query"sv),
+			json::MakeField<NodeT, &detail::Query::radius>("radius"sv),
+			json::MakeField<NodeT, &detail::Query::to>("to"sv),
+			json::MakeField<NodeT, &detail::Query::typeOfQuery>("type"sv),
+		} };
+		static_assert(json::IsSorted(querySchema<json::NodeView>));
+
+		// fields which depend on type of request, they are set after all keys are read
+		void FinishQuery(detail::Query& query) {
+			query.type = detail::GetQueryType(query.typeOfQuery);
+			// name is read as name of stop, it belongs to bus only in Bus request
+			if (query.typeOfQuery == "Bus"sv) {
+				query.nameBus = std::move(query.nameStop);
+				query.nameStop.clear();
+			}
+		}
+
+		detail::Query DecodeQuery(const json::DictView request) {
+			detail::Query result;
+			json::Decode(request, querySchema<json::NodeView>, result);
+			FinishQuery(result);
+			return result;
+		}
+
+		template <typename NodeT>
+		constexpr json::Schema<renderer::Settings, NodeT, 12> renderSchema{ {
+			json::MakeField<NodeT, &renderer::Settings::bus_label_font_size>("bus_label_font_size"sv),
+			json::MakeField<NodeT, &renderer::Settings::bus_label_offset>("bus_label_offset"sv),
+			{ "color_palette"sv, &DecodePalette<NodeT> },
+			json::MakeField<NodeT, &renderer::Settings::height>("height"sv),
+			json::MakeField<NodeT, &renderer::Settings::line_width>("line_width"sv),
+			json::MakeField<NodeT, &renderer::Settings::padding>("padding"sv),
+			json::MakeField<NodeT, &renderer::Settings::stop_label_font_size>("stop_label_font_size"sv),
+			json::MakeField<NodeT, &renderer::Settings::stop_label_offset>("stop_label_offset"sv),
+			json::MakeField<NodeT, &renderer::Settings::stop_radius>("stop_radius"sv),
+			{ "underlayer_color"sv, &DecodeUnderlayerColor<NodeT> },
+			json::MakeField<NodeT, &renderer::Settings::underlayer_width>("underlayer_width"sv),
+			json::MakeField<NodeT, &renderer::Settings::width>("width"sv),
+		} };
+		static_assert(json::IsSorted(renderSchema<json::NodeView>));
+
+		template <typename NodeT>
+		constexpr json::Schema<detail::RouteSet, NodeT, 2> routingSchema{ {
+			json::MakeField<NodeT, &detail::RouteSet::velocity>("bus_velocity"sv),
+			json::MakeField<NodeT, &detail::RouteSet::waitTime>("bus_wait_time"sv),
+		} };
+		static_assert(json::IsSorted(routingSchema<json::NodeView>));
+	}
+
+	detail::QueryType detail::GetQueryType(std::string_view name)
+	{
+		static const std::unordered_map<std::string_view, QueryType> types{
+			{ "Bus"sv, QueryType::Bus },
+			{ "Stop"sv, QueryType::Stop },
+			{ "Route"sv, QueryType::Route },
+			{ "Map"sv, QueryType::Map },
+			{ "NearestStops"sv, QueryType::NearestStops },
+			{ "StopSearch"sv, QueryType::StopSearch },
+			{ "Stats"sv, QueryType::Stats },
+		};
+		const auto it = types.find(name);
+		return it == types.end() ? QueryType::Unknown : it->second;
+	}
 
 	/******************************Read***********************************/
 	std::vector<std::string> JsonReader::GetStopsRoute(json::Node& input) {
@@ -193,486 +329,1178 @@ namespace reader
 		return queryTowardStop;
 	}
 
-	std::deque<detail::Query> JsonReader::ReadGetQuery(const json::Node& input) {
+	std::deque<detail::Query> JsonReader::ReadGetQuery(const json::NodeView input) {
 
 		std::deque<detail::Query> queriesToBase;
 
-		json::Array arr_data = input.AsArray();
-
-		size_t reqNum = arr_data.size();
-		// collect data for query of request to base
-		for (int i = 0; i < reqNum; ++i) {
-			detail::Query result;
-
-			if (arr_data[i].IsDict() && arr_data[i].AsDict().empty()) {
+		for (const json::NodeView request : input.AsArray()) {
+			const json::DictView currReq = request.AsDict();
+			if (currReq.empty()) {
 				continue;
 			}
-			json::Node currReq = arr_data[i];
+			// push data to container	
+			queriesToBase.push_back(DecodeQuery(currReq));
+		}
+		return queriesToBase;
+	}
 
-			// getting type of query
-			if (currReq.AsDict().count(type) && currReq.AsDict().at(type).IsString()) {
-				result.typeOfQuery = currReq.AsDict().at(type).AsString();
-			}
+	void JsonReader::ReadRenderQuery(const json::Dict& dict_sets, renderer::Settings& setup)
+	{
+		json::Decode(dict_sets, renderSchema<json::Node>, setup);
+	}
 
-			// getting number of bus
-			if (result.typeOfQuery == "Bus"sv) {
+	void JsonReader::ReadRenderQuery(const json::DictView dict_sets, renderer::Settings& setup)
+	{
+		json::Decode(dict_sets, renderSchema<json::NodeView>, setup);
+	}
 
-				if (currReq.AsDict().count(id) && currReq.AsDict().at(id).IsInt()) {
-					result.id_query = currReq.AsDict().at(id).AsInt();
-				}
+	detail::RouteSet JsonReader::ReadRoutingQuery(const json::Dict& input)
+	{
+		detail::RouteSet routeSet{};
+		json::Decode(input, routingSchema<json::Node>, routeSet);
+		return routeSet;
+	}
 
-				if (currReq.AsDict().count(name) && currReq.AsDict().at(name).IsString()) {
-					result.nameBus = currReq.AsDict().at(name).AsString();
+	detail::RouteSet JsonReader::ReadRoutingQuery(const json::DictView input)
+	{
+		detail::RouteSet routeSet{};
+		json::Decode(input, routingSchema<json::NodeView>, routeSet);
+		return routeSet;
+	}
+
+	ResponseData JsonReader::ReadData(std::istream & input, renderer::Settings& setup, std::size_t threads) {
+
+		if (binary::IsBinary(input)) {
+			return binary::Read(input, setup);
+		}
+
+		std::deque<detail::Query> queriesToAdd;
+		std::deque<std::unordered_map<std::string, std::vector<detail::Distance>>> queryTowardStop;
+		std::deque<detail::Query> queriesToBase;
+		detail::RouteSet routeSettings;
+		std::string nameBase;
+
+		// base_requests and stat_requests are split between threads
+		const json::ArenaDocument doc(input, threads);
+		const json::NodeView root = doc.GetRoot();
+
+		if (root.IsDict() && root.AsDict().empty()) {
+			return { queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase };
+		}
+
+		for (const auto& query : root.AsDict()) {
+			if (query.first == baseReq) {
+				/**********Read query to add data***********/
+				if (query.second.IsArray() && query.second.AsArray().empty()) {
+					continue;
 				}
+				const json::Node requests = query.second.ToNode();
+				queriesToAdd = ReadAddQuery(requests);
+				queryTowardStop = ReadAddTowardStop(requests);
 			}
-			else if (result.typeOfQuery == "Map"sv) {
-
-				if (currReq.AsDict().count(id) && currReq.AsDict().at(id).IsInt()) {
-					result.id_query = currReq.AsDict().at(id).AsInt();
+			else if (query.first == statReq) {
+				/********Read query to get data************/
+				if (query.second.IsArray() && query.second.AsArray().empty()) {
+					continue;
 				}
+				queriesToBase = ReadGetQuery(query.second);
 			}
-			else if (result.typeOfQuery == "Route"sv) {
-
-				if (currReq.AsDict().count(id) && currReq.AsDict().at(id).IsInt()) {
-					result.id_query = currReq.AsDict().at(id).AsInt();
+			else if (query.first == rendSet) {
+				/**********Read settings into map_renderer******/
+				if (query.second.IsDict() && query.second.AsDict().empty()) {
+					continue;
 				}
-				if (currReq.AsDict().count(from) && currReq.AsDict().at(from).IsString()) {
-					result.from = currReq.AsDict().at(from).AsString();
+				ReadRenderQuery(query.second.AsDict(), setup);
+			}
+			else if (query.first == routeSet) {
+				/**********Read settings into Route******/
+				if (query.second.IsDict() && query.second.AsDict().empty()) {
+					continue;
 				}
-				if (currReq.AsDict().count(to) && currReq.AsDict().at(to).IsString()) {
-					result.to = currReq.AsDict().at(to).AsString();
+				routeSettings = ReadRoutingQuery(query.second.AsDict());
+			}
+			else if(query.first == serialSet) {
+				/**********Read settings serialization******/
+				if (query.second.IsDict() && query.second.AsDict().empty()) {
+					continue;
 				}
+				nameBase = query.second.AsDict().at("file").AsString();
 			}
 			else {
-				if (currReq.AsDict().count(id) && currReq.AsDict().at(id).IsInt()) {
-					result.id_query = currReq.AsDict().at(id).AsInt();
-				}
+				json::ParsingError("Input data is wrong"s);
+			}
+		}
 
-				if (currReq.AsDict().count(name) && currReq.AsDict().at(name).IsString()) {
-					result.nameStop = currReq.AsDict().at(name).AsString();
+		return { std::move(queriesToAdd), std::move(queryTowardStop), std::move(queriesToBase),
+			routeSettings, std::move(nameBase) };
+	}
+
+	ResponseData JsonReader::ReadRequests(std::istream& input, std::size_t threads, detail::UpdateData* update) {
+
+		if (binary::IsBinary(input)) {
+			return binary::ReadRequests(input);
+		}
+
+		ResponseData result;
+		auto& [queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase] = result;
+		routeSettings = detail::RouteSet{};
+
+		json::LazyDocument doc(input, threads);
+		if (doc.Contains(statReq)) {
+			queriesToBase = ReadGetQuery(doc.Get(statReq));
+		}
+		if (doc.Contains(serialSet)) {
+			const json::DictView settings = doc.Get(serialSet).AsDict();
+			if (!settings.empty()) {
+				nameBase = settings.at("file"sv).AsString();
+			}
+		}
+		if (update != nullptr && doc.Contains(updateReq)) {
+			for (const json::NodeView request : doc.Get(updateReq).AsArray()) {
+				ReadUpdateRequest(request.ToNode().AsDict(), *update);
+			}
+		}
+		return result;
+	}
+
+	detail::Query JsonReader::ReadQuery(std::string text) {
+
+		queryDoc_.Load(std::move(text));
+		const json::DictView request = queryDoc_.GetRoot().AsDict();
+		if (request.empty()) {
+			throw std::runtime_error("empty request"s);
+		}
+		return DecodeQuery(request);
+	}
+
+	namespace {
+		std::string_view KeepName(std::unordered_set<std::string>& names, const std::string& name)
+		{
+			return *names.insert(name).first;
+		}
+	}
+
+	void JsonReader::ReadBaseRequest(const json::Dict& request, detail::BaseData& base)
+	{
+		if (!request.count(type) || !request.at(type).IsString()) {
+			return;
+		}
+		const std::string& typeOfQuery = request.at(type).AsString();
+		std::string_view nameData;
+		if (request.count(name) && request.at(name).IsString()) {
+			nameData = KeepName(base.names, request.at(name).AsString());
+		}
+
+		if (typeOfQuery == "Stop"s) {
+			tc::StopData stop{ nameData };
+			if (request.count(lat) && request.at(lat).IsDouble()) {
+				stop.latitude = request.at(lat).AsDouble();
+			}
+			if (request.count(lng) && request.at(lng).IsDouble()) {
+				stop.longitude = request.at(lng).AsDouble();
+			}
+			base.stops.push_back(stop);
+
+			if (request.count(dist) && request.at(dist).IsDict()) {
+				for (const auto& [toStop, distance] : request.at(dist).AsDict()) {
+					base.distances.push_back({ nameData, KeepName(base.names, toStop),
+						static_cast<unsigned int>(distance.IsInt() ? distance.AsInt() : 0) });
 				}
 			}
-			// push data to container	
-			queriesToBase.push_back(result);
 		}
-		return queriesToBase;
+		else if (typeOfQuery == "Bus"s) {
+			std::vector<std::string_view> routeStops;
+			if (request.count(stops) && request.at(stops).IsArray()) {
+				for (const auto& nameStop : request.at(stops).AsArray()) {
+					if (nameStop.IsString()) {
+						routeStops.push_back(KeepName(base.names, nameStop.AsString()));
+					}
+				}
+			}
+			bool isRing = false;
+			if (request.count(isRoundRoute) && request.at(isRoundRoute).IsBool()) {
+				isRing = request.at(isRoundRoute).AsBool();
+			}
+			base.buses.push_back({ nameData, tc::MakeFullRoute(std::move(routeStops), isRing), isRing });
+		}
 	}
 
-	void JsonReader::ReadRenderQuery(const json::Dict & dict_sets, renderer::Settings& setup)
+	void JsonReader::ReadUpdateRequest(const json::Dict& request, detail::UpdateData& update)
 	{
-		// save in structure
-		if (dict_sets.at("width"s).IsDouble()) {
-			setup.width = dict_sets.at("width"s).AsDouble();
+		if (!request.count(removed) || !request.at(removed).IsBool() || !request.at(removed).AsBool()) {
+			ReadBaseRequest(request, update.base);
+			return;
+		}
+		if (!request.count(type) || !request.at(type).IsString()
+			|| !request.count(name) || !request.at(name).IsString()) {
+			return;
 		}
-		if (dict_sets.at("height"s).IsDouble()) {
-			setup.height = dict_sets.at("height"s).AsDouble();
+		const std::string& typeOfQuery = request.at(type).AsString();
+		const std::string_view nameData = KeepName(update.base.names, request.at(name).AsString());
+		if (typeOfQuery == "Stop"s) {
+			update.removedStops.push_back(nameData);
 		}
-		if (dict_sets.at("padding"s).IsDouble()) {
-			setup.padding = dict_sets.at("padding"s).AsDouble();
+		else if (typeOfQuery == "Bus"s) {
+			update.removedBuses.push_back(nameData);
 		}
-		if (dict_sets.at("line_width"s).IsDouble()) {
-			setup.line_width = dict_sets.at("line_width"s).AsDouble();
+	}
+
+	// document is passed by parts: each element of base_requests and each other
+	// section of root is collected by builder and handled as soon as it is closed
+	class JsonReader::BaseHandler final : public json::Handler {
+	public:
+		BaseHandler(JsonReader& reader, detail::BaseData& base, renderer::Settings& setup)
+			: reader_(reader), base_(base), setup_(setup) {
 		}
-		if (dict_sets.at("stop_radius"s).IsDouble()) {
-			setup.stop_radius = dict_sets.at("stop_radius"s).AsDouble();
+
+		void StartDict() override {
+			++depth_;
+			if (depth_ > 1) {
+				GetBuilder().StartDict();
+			}
 		}
-		if (dict_sets.at("bus_label_font_size"s).IsInt()) {
-			setup.bus_label_font_size = dict_sets.at("bus_label_font_size"s).AsInt();
+
+		void Key(std::string key) override {
+			if (depth_ == 1) {
+				section_ = std::move(key);
+			}
+			else {
+				builder_->Key(std::move(key));
+			}
 		}
-		if (dict_sets.at("bus_label_offset"s).IsArray()) {
-			std::size_t sizeArr_bus = dict_sets.at("bus_label_offset"s).AsArray().size();
-			for (std::size_t i = 0; i < sizeArr_bus; i++) {
-				if (dict_sets.at("bus_label_offset"s).AsArray()[i].IsDouble()) {
-					setup.bus_label_offset.push_back(dict_sets.at("bus_label_offset"s).AsArray()[i].AsDouble());
-				}
+
+		void EndDict() override {
+			if (depth_ > 1) {
+				builder_->EndDict();
 			}
+			--depth_;
+			TryFinish();
 		}
-		if (dict_sets.at("stop_label_font_size"s).IsInt()) {
-			setup.stop_label_font_size = dict_sets.at("stop_label_font_size"s).AsInt();
+
+		void StartArray() override {
+			if (depth_ == 0) {
+				throw json::ParsingError("Input data is wrong"s);
+			}
+			++depth_;
+			// array of base requests itself is not collected
+			if (!(depth_ == 2 && section_ == baseReq)) {
+				GetBuilder().StartArray();
+			}
 		}
-		if (dict_sets.at("stop_label_offset"s).IsArray()) {
-			std::size_t sizeArr_stop = dict_sets.at("stop_label_offset"s).AsArray().size();
-			for (std::size_t i = 0; i < sizeArr_stop; i++) {
-				if (dict_sets.at("stop_label_offset"s).AsArray()[i].IsDouble()) {
-					setup.stop_label_offset.push_back(dict_sets.at("stop_label_offset"s).AsArray()[i].AsDouble());
-				}
+
+		void EndArray() override {
+			if (builder_) {
+				builder_->EndArray();
 			}
+			--depth_;
+			TryFinish();
 		}
-		/*****************underlayer_color***************/
-		if (dict_sets.at("underlayer_color"s).IsArray()
-			|| dict_sets.at("underlayer_color"s).IsString()) {
 
-			// define color by one word? like "green" or "red"
-			if (dict_sets.at("underlayer_color"s).IsString())
-			{
-				setup.underlayer_color = { dict_sets.at("underlayer_color"s).AsString() };
+		void Value(json::Node value) override {
+			if (depth_ == 0) {
+				throw json::ParsingError("Input data is wrong"s);
 			}
-			else if (dict_sets.at("underlayer_color"s).IsArray())
-			{
-				std::size_t sizeArr = dict_sets.at("underlayer_color"s).AsArray().size();
-				// define which type of RGB 
-				if (sizeArr == 3) {
+			GetBuilder().Value(std::move(value));
+			TryFinish();
+		}
 
-					std::uint8_t int_11 = dict_sets.at("underlayer_color"s).AsArray()[0].AsInt();
-					std::uint8_t int_21 = dict_sets.at("underlayer_color"s).AsArray()[1].AsInt();
-					std::uint8_t int_31 = dict_sets.at("underlayer_color"s).AsArray()[2].AsInt();
+	private:
+		JsonReader& reader_;
+		detail::BaseData& base_;
+		renderer::Settings& setup_;
+		// 1 inside root dict
+		std::size_t depth_ = 0;
+		// key of root dict being read
+		std::string section_;
+		std::optional<json::Builder> builder_;
+
+		json::Builder& GetBuilder() {
+			if (!builder_) {
+				builder_.emplace();
+			}
+			return *builder_;
+		}
 
-					setup.underlayer_color = svg::Rgb{ int_11, int_21, int_31 };
-				}
-				// or RGBa
-				else if (sizeArr == 4)
-				{
-					std::uint8_t int_1 = dict_sets.at("underlayer_color"s).AsArray()[0].AsInt();
-					std::uint8_t int_2 = dict_sets.at("underlayer_color"s).AsArray()[1].AsInt();
-					std::uint8_t int_3 = dict_sets.at("underlayer_color"s).AsArray()[2].AsInt();
-					auto dbl_4 = dict_sets.at("underlayer_color"s).AsArray()[3].AsDouble();
+		// handle collected part when it is closed
+		void TryFinish() {
+			const std::size_t partDepth = section_ == baseReq ? 2 : 1;
+			if (!builder_ || depth_ != partDepth) {
+				return;
+			}
+			const json::Node part = builder_->Build();
+			builder_.reset();
 
-					setup.underlayer_color = svg::Rgba{ int_1, int_2, int_3, dbl_4 };
+			if (section_ == baseReq) {
+				if (!(part.IsDict() && part.AsDict().empty())) {
+					reader_.ReadBaseRequest(part.AsDict(), base_);
+				}
+			}
+			else if (section_ == rendSet) {
+				if (!(part.IsDict() && part.AsDict().empty())) {
+					reader_.ReadRenderQuery(part.AsDict(), setup_);
+				}
+			}
+			else if (section_ == routeSet) {
+				if (!(part.IsDict() && part.AsDict().empty())) {
+					base_.routeSettings = reader_.ReadRoutingQuery(part.AsDict());
+				}
+			}
+			else if (section_ == serialSet) {
+				if (!(part.IsDict() && part.AsDict().empty())) {
+					base_.nameBase = part.AsDict().at("file").AsString();
 				}
 			}
 		}
+	};
 
-		/****************underlayer_width****************/
-		if (dict_sets.at("underlayer_width"s).IsDouble()) {
-			setup.underlayer_width = dict_sets.at("underlayer_width"s).AsDouble();
+	detail::BaseData JsonReader::ReadBase(std::istream& input, renderer::Settings& setup)
+	{
+		if (binary::IsBinary(input)) {
+			return binary::ReadBase(input, setup);
 		}
-		/****************read color_palette**************/
-		if (dict_sets.at("color_palette"s).IsArray()) {
-			std::size_t sizeArr_color = dict_sets.at("color_palette"s).AsArray().size();
-			for (std::size_t i = 0; i < sizeArr_color; i++) {
+		detail::BaseData base;
+		BaseHandler handler(*this, base, setup);
+		json::Parse(input, handler);
+		return base;
+	}
 
-				// define color by one word? like "green" or "red"
-				if (dict_sets.at("color_palette"s).AsArray()[i].IsString())
-				{
-					setup.color_palette.push_back(dict_sets.at("color_palette"s).AsArray()[i].AsString());
-				}
-				else if (dict_sets.at("color_palette"s).AsArray()[i].IsArray())
-				{
-					std::size_t sizeArr = dict_sets.at("color_palette"s).AsArray()[i].AsArray().size();
-					// define which type of RGB 
-					if (sizeArr == 3) {
 
-						std::uint8_t int_11 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[0].AsInt();
-						std::uint8_t int_21 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[1].AsInt();
-						std::uint8_t int_31 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[2].AsInt();
+	/*********************************Write******************************/
+	namespace {
+		// time of answer by type of request, index is QueryType
+		profile::Probe requestProbes[] = {
+			profile::Probe{ "request Unknown"sv },
+			profile::Probe{ "request Bus"sv },
+			profile::Probe{ "request Stop"sv },
+			profile::Probe{ "request Route"sv },
+			profile::Probe{ "request Map"sv },
+			profile::Probe{ "request NearestStops"sv },
+			profile::Probe{ "request StopSearch"sv },
+			profile::Probe{ "request Stats"sv },
+		};
+
+		// names of request are resolved by catalogue of handler
+		detail::StatRequest BindRequest(const detail::Query& query, const handler::RequestHandler& reqHandler)
+		{
+			detail::StatRequest request;
+			request.type = query.type;
+			request.id = query.id_query;
+			switch (query.type) {
+			case detail::QueryType::Bus:
+				request.bus = reqHandler.FindBus(query.nameBus);
+				break;
+			case detail::QueryType::Stop:
+				// stop without name is not found even if base has such one
+				request.stop = query.nameStop.empty() ? nullptr : reqHandler.FindStop(query.nameStop);
+				break;
+			case detail::QueryType::Route:
+				request.stop = reqHandler.FindStop(query.from);
+				request.toStop = reqHandler.FindStop(query.to);
+				break;
+			default:
+				break;
+			}
+			return request;
+		}
 
-						setup.color_palette.push_back(svg::Rgb{ int_11, int_21, int_31 });
-					}
-					// or RGBa
-					else if (sizeArr == 4)
-					{
-						std::uint8_t int_1 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[0].AsInt();
-						std::uint8_t int_2 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[1].AsInt();
-						std::uint8_t int_3 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[2].AsInt();
-						auto dbl_4 = dict_sets.at("color_palette"s).AsArray()[i].AsArray()[3].AsDouble();
-
-						setup.color_palette.push_back(svg::Rgba{ int_1, int_2, int_3, dbl_4 });
-					}
-					else
-					{
-						continue;
-					}
+		// answer of request depends on its parameters only, not on id, for these types
+		bool IsShareable(detail::QueryType type)
+		{
+			switch (type) {
+			case detail::QueryType::Bus:
+			case detail::QueryType::Stop:
+			case detail::QueryType::Route:
+			case detail::QueryType::NearestStops:
+			case detail::QueryType::StopSearch:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// parameters of request which its answer depends on: resolved objects
+		// instead of names, so all requests of unknown objects are the same
+		auto GetParameters(const detail::StatRequest& request, const detail::Query& query)
+		{
+			return std::tie(request.type, request.bus, request.stop, request.toStop,
+				query.latitude, query.longitude, query.radius, query.limit, query.text, query.maxEdits);
+		}
+
+		// requests are given by indexes in batch, so keys are not copied
+		class ParametersHasher {
+		public:
+			ParametersHasher(const std::vector<detail::StatRequest>& requests,
+				const std::deque<detail::Query>& queries) : requests_(requests), queries_(queries) {}
+
+			std::size_t operator()(std::size_t q) const {
+				std::size_t h = 0;
+				std::apply([&h](const auto&... parameter) {
+					((h = h * 37 + std::hash<std::decay_t<decltype(parameter)>>{}(parameter)), ...);
+				}, GetParameters(requests_[q], queries_[q]));
+				return h;
+			}
+
+		private:
+			const std::vector<detail::StatRequest>& requests_;
+			const std::deque<detail::Query>& queries_;
+		};
+
+		class SameParameters {
+		public:
+			SameParameters(const std::vector<detail::StatRequest>& requests,
+				const std::deque<detail::Query>& queries) : requests_(requests), queries_(queries) {}
+
+			bool operator()(std::size_t lhs, std::size_t rhs) const {
+				return GetParameters(requests_[lhs], queries_[lhs]) == GetParameters(requests_[rhs], queries_[rhs]);
+			}
+
+		private:
+			const std::vector<detail::StatRequest>& requests_;
+			const std::deque<detail::Query>& queries_;
+		};
+
+		// requests of batch which are the same but id are answered once
+		struct BatchPlan {
+			static constexpr std::size_t unique = std::numeric_limits<std::size_t>::max();
+			// for each request: index of shared answer, unique for request without copies
+			std::vector<std::size_t> answerOf;
+			// for each shared answer: the first of requests sharing it
+			std::vector<std::size_t> owners;
+		};
+
+		BatchPlan MakePlan(const std::vector<detail::StatRequest>& requests, const std::deque<detail::Query>& queries)
+		{
+			BatchPlan plan;
+			plan.answerOf.assign(requests.size(), BatchPlan::unique);
+			// the first request with parameters -> index of its shared answer
+			std::unordered_map<std::size_t, std::size_t, ParametersHasher, SameParameters> firsts(
+				requests.size(), ParametersHasher(requests, queries), SameParameters(requests, queries));
+			for (std::size_t q = 0; q < requests.size(); ++q) {
+				if (!IsShareable(requests[q].type)) {
+					continue;
 				}
-				else {
+				auto [it, inserted] = firsts.try_emplace(q, BatchPlan::unique);
+				if (inserted) {
 					continue;
 				}
+				auto& [first, answer] = *it;
+				if (answer == BatchPlan::unique) {
+					answer = plan.owners.size();
+					plan.owners.push_back(first);
+					plan.answerOf[first] = answer;
+				}
+				plan.answerOf[q] = answer;
+			}
+			return plan;
+		}
+
+		// answer of owner of shared answer split around value of its id,
+		// copies get the same text with own id in between
+		struct SharedAnswer {
+			std::string text;
+			std::size_t idBegin = 0;
+			std::size_t idEnd = 0;
+		};
 
+		SharedAnswer MakeSharedAnswer(std::string text)
+		{
+			SharedAnswer answer;
+			// quote after key can't be in string value unescaped, so it's the key
+			static constexpr std::string_view idKey = "\"request_id\": "sv;
+			answer.idBegin = text.find(idKey);
+			if (answer.idBegin == std::string::npos) {
+				throw std::logic_error("Answer has no request_id"s);
+			}
+			answer.idBegin += idKey.size();
+			answer.idEnd = text.find_first_not_of("-0123456789"sv, answer.idBegin);
+			answer.text = std::move(text);
+			return answer;
+		}
 
+		// calls task(chunk) for chunks [0, count) by threads of pool,
+		// without pool by current thread only
+		template <typename Task>
+		void ForEachChunk(std::size_t count, pool::ThreadPool* workers, Task task)
+		{
+			if (workers != nullptr) {
+				workers->ForEach(count, task);
+				return;
 			}
+			for (std::size_t i = 0; i < count; ++i) {
+				task(i);
+			}
+		}
+	}
+
+	pool::ThreadPool& JsonReader::GetPool(std::size_t threads) {
+		if (!pool_ || pool_->GetSize() != threads) {
+			pool_.reset();
+			pool_ = std::make_unique<pool::ThreadPool>(threads);
 		}
+		return *pool_;
 	}
 
-	detail::RouteSet JsonReader::ReadRoutingQuery(const json::Dict & input)
+	BatchStats JsonReader::GetData(std::ostream& output, const handler::RequestHandler& reqHandler,
+		const std::deque<detail::Query>& queriesReq, std::size_t threads, const Framing& framing)
 	{
-		detail::RouteSet routeSet;
+		const bool parallel = threads > 1 && queriesReq.size() > requestsPerChunk;
+		pool::ThreadPool* workers = parallel ? &GetPool(threads) : nullptr;
+
+		// names are resolved once for all requests, answers use resolved objects
+		std::vector<detail::StatRequest> requests(queriesReq.size());
+		ForEachChunk((requests.size() + requestsPerChunk - 1) / requestsPerChunk, workers, [&](std::size_t i) {
+			const std::size_t last = std::min((i + 1) * requestsPerChunk, requests.size());
+			for (std::size_t q = i * requestsPerChunk; q < last; ++q) {
+				requests[q] = BindRequest(queriesReq[q], reqHandler);
+			}
+		});
+
+		// answers shared by copies of requests are made before the rest
+		const BatchPlan plan = MakePlan(requests, queriesReq);
+		std::vector<SharedAnswer> shared(plan.owners.size());
+		ForEachChunk((shared.size() + requestsPerChunk - 1) / requestsPerChunk, workers, [&](std::size_t i) {
+			const std::size_t last = std::min((i + 1) * requestsPerChunk, shared.size());
+			for (std::size_t s = i * requestsPerChunk; s < last; ++s) {
+				std::ostringstream stream;
+				stream.precision(output.precision());
+				{
+					json::Writer answerWriter(stream);
+					const std::size_t owner = plan.owners[s];
+					PrintQuery(answerWriter, reqHandler, requests[owner], queriesReq[owner], ""sv);
+				}
+				shared[s] = MakeSharedAnswer(std::move(stream).str());
+			}
+		});
+
+		BatchStats stats;
+		stats.requests = queriesReq.size();
+		stats.computed = stats.requests;
+		for (const std::size_t answer : plan.answerOf) {
+			if (answer != BatchPlan::unique) {
+				--stats.computed;
+			}
+		}
+		stats.computed += shared.size();
+
+		// request is answered by shared answer or by itself
+		const auto print = [&](json::Writer& writer, std::size_t q, std::string_view separator) {
+			const std::size_t answer = plan.answerOf[q];
+			if (answer == BatchPlan::unique) {
+				return PrintQuery(writer, reqHandler, requests[q], queriesReq[q], separator);
+			}
+			const SharedAnswer& sharedAnswer = shared[answer];
+			const std::string_view text = sharedAnswer.text;
+			char id[16];
+			const auto result = std::to_chars(std::begin(id), std::end(id), queriesReq[q].id_query);
+			writer.Raw(separator)
+				.Raw(text.substr(0, sharedAnswer.idBegin))
+				.Raw({ id, static_cast<std::size_t>(result.ptr - id) })
+				.Raw(text.substr(sharedAnswer.idEnd));
+			return true;
+		};
 
-		if (input.at(velocity).IsDouble()) {
-			routeSet.velocity = input.at(velocity).AsDouble();
+		bool first_printed{ false };
+		json::Writer writer(output);
+
+		writer.Raw(framing.begin);
+
+		if (!parallel) {
+			for (std::size_t q = 0; q < queriesReq.size(); ++q) {
+				if (print(writer, q, first_printed ? framing.separator : ""sv)) {
+					first_printed = true;
+				}
+			}
+			writer.Raw(framing.end);
+			return stats;
 		}
-		if (input.at(time).IsInt()) {
-			routeSet.waitTime = input.at(time).AsInt();
+
+		// requests are answered by batches: threads take chunks of batch one by one
+		// and write answers into own buffer of chunk, then buffers are written in order
+		struct Chunk {
+			std::string text;
+			bool printed = false;
+		};
+		const std::size_t batchSize = threads * chunksPerThread * requestsPerChunk;
+		std::vector<Chunk> chunks;
+		for (std::size_t batch = 0; batch < queriesReq.size(); batch += batchSize) {
+			const std::size_t batchEnd = std::min(batch + batchSize, queriesReq.size());
+			chunks.assign((batchEnd - batch + requestsPerChunk - 1) / requestsPerChunk, Chunk{});
+			ForEachChunk(chunks.size(), workers, [&, batch, batchEnd](std::size_t i) {
+				std::ostringstream stream;
+				stream.precision(output.precision());
+				{
+					json::Writer chunkWriter(stream);
+					const std::size_t first = batch + i * requestsPerChunk;
+					const std::size_t last = std::min(first + requestsPerChunk, batchEnd);
+					for (std::size_t q = first; q < last; ++q) {
+						if (print(chunkWriter, q, chunks[i].printed ? framing.separator : ""sv)) {
+							chunks[i].printed = true;
+						}
+					}
+				}
+				chunks[i].text = std::move(stream).str();
+			});
+
+			for (const Chunk& chunk : chunks) {
+				if (!chunk.printed) {
+					continue;
+				}
+				if (first_printed) {
+					writer.Raw(framing.separator);
+				}
+				writer.Raw(chunk.text);
+				first_printed = true;
+			}
 		}
-		return routeSet;
+		writer.Raw(framing.end);
+		return stats;
 	}
 
-	ResponseData JsonReader::ReadData(std::istream & input, renderer::Settings& setup) {
+	/*********************************Pipeline***************************/
+	namespace {
+		// answers of chunk of requests, chunks are joined by separator of array
+		constexpr Framing chunkFraming{ ""sv, ",\n"sv, ""sv };
+
+		struct ChunkAnswer {
+			std::string text;
+			BatchStats stats;
+		};
+
+		// chunks of requests go from parser to workers, their answers go to writer
+		// in order of chunks. Parser waits while writer is behind by maxChunks chunks,
+		// but not before name of base is known: nobody takes chunks before it
+		class Pipeline {
+		public:
+			explicit Pipeline(std::size_t maxChunks) : maxChunks_(maxChunks) {}
+
+			void Push(std::deque<detail::Query> chunk) {
+				std::unique_lock<std::mutex> lock(mutex_);
+				changed_.wait(lock, [this] { return stopped_ || !base_ || pushed_ - written_ < maxChunks_; });
+				if (stopped_) {
+					throw std::runtime_error("Pipeline is stopped"s);
+				}
+				queue_.emplace_back(pushed_++, std::move(chunk));
+				changed_.notify_all();
+			}
 
-		std::deque<detail::Query> queriesToAdd;
-		std::deque<std::unordered_map<std::string, std::vector<detail::Distance>>> queryTowardStop;
-		std::deque<detail::Query> queriesToBase;
-		detail::RouteSet routeSettings;
-		std::string nameBase;
+			void SetBase(std::string name) {
+				std::lock_guard<std::mutex> guard(mutex_);
+				base_ = std::move(name);
+				changed_.notify_all();
+			}
 
-		const json::Node root = LoadJSON(input).GetRoot();
+			// input is read up to end or up to error
+			void Finish(std::exception_ptr error) {
+				std::lock_guard<std::mutex> guard(mutex_);
+				parsed_ = true;
+				if (error) {
+					StopLocked(std::move(error));
+				}
+				changed_.notify_all();
+			}
 
-		if (root.IsDict() && root.AsDict().empty()) {
-			return { queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase };
-		}
+			// the first error is kept, it's thrown to writer
+			void Stop(std::exception_ptr error) {
+				std::lock_guard<std::mutex> guard(mutex_);
+				StopLocked(std::move(error));
+				changed_.notify_all();
+			}
 
-		json::Dict queries = root.AsDict();
+			// empty name if input has no serialization settings
+			std::string WaitBase() {
+				std::unique_lock<std::mutex> lock(mutex_);
+				changed_.wait(lock, [this] { return stopped_ || base_ || parsed_; });
+				ThrowIfStopped();
+				return base_.value_or(std::string{});
+			}
 
-		for (auto& query : queries) {
-			if (query.first == baseReq) {
-				/**********Read query to add data***********/
-				if (query.second.IsArray() && query.second.AsArray().empty()) {
-					continue;
+			// chunk and its index, nullopt when there are no more chunks
+			std::optional<std::pair<std::size_t, std::deque<detail::Query>>> Pop() {
+				std::unique_lock<std::mutex> lock(mutex_);
+				changed_.wait(lock, [this] { return stopped_ || !queue_.empty() || parsed_; });
+				if (stopped_ || queue_.empty()) {
+					return std::nullopt;
 				}
-				queriesToAdd = ReadAddQuery(query.second);
-				queryTowardStop = ReadAddTowardStop(query.second);
+				auto chunk = std::move(queue_.front());
+				queue_.pop_front();
+				return chunk;
 			}
-			else if (query.first == statReq) {
-				/********Read query to get data************/
-				if (query.second.IsArray() && query.second.AsArray().empty()) {
-					continue;
+
+			void Done(std::size_t index, ChunkAnswer answer) {
+				std::lock_guard<std::mutex> guard(mutex_);
+				done_.emplace(index, std::move(answer));
+				changed_.notify_all();
+			}
+
+			// answer of the next chunk in order, nullopt after the last one
+			std::optional<ChunkAnswer> Next() {
+				std::unique_lock<std::mutex> lock(mutex_);
+				changed_.wait(lock, [this] {
+					return stopped_ || done_.count(written_) || (parsed_ && written_ == pushed_);
+				});
+				ThrowIfStopped();
+				const auto it = done_.find(written_);
+				if (it == done_.end()) {
+					return std::nullopt;
 				}
-				queriesToBase = ReadGetQuery(query.second);
+				ChunkAnswer answer = std::move(it->second);
+				done_.erase(it);
+				++written_;
+				changed_.notify_all();
+				return answer;
 			}
-			else if (query.first == rendSet) {
-				/**********Read settings into map_renderer******/
-				if (query.second.IsDict() && query.second.AsDict().empty()) {
-					continue;
+
+		private:
+			const std::size_t maxChunks_;
+			std::mutex mutex_;
+			std::condition_variable changed_;
+			std::deque<std::pair<std::size_t, std::deque<detail::Query>>> queue_;
+			// answers waiting for previous ones
+			std::map<std::size_t, ChunkAnswer> done_;
+			std::size_t pushed_ = 0;
+			std::size_t written_ = 0;
+			std::optional<std::string> base_;
+			bool parsed_ = false;
+			bool stopped_ = false;
+			std::exception_ptr error_;
+
+			void StopLocked(std::exception_ptr error) {
+				if (!error_) {
+					error_ = std::move(error);
 				}
-				ReadRenderQuery(query.second.AsDict(), setup);
+				stopped_ = true;
 			}
-			else if (query.first == routeSet) {
-				/**********Read settings into Route******/
-				if (query.second.IsDict() && query.second.AsDict().empty()) {
-					continue;
+
+			void ThrowIfStopped() const {
+				if (stopped_) {
+					std::rethrow_exception(error_);
 				}
-				routeSettings = ReadRoutingQuery(query.second.AsDict());
 			}
-			else if(query.first == serialSet) {
-				/**********Read settings serialization******/
-				if (query.second.IsDict() && query.second.AsDict().empty()) {
-					continue;
+		};
+
+		// stat requests are decoded while input is parsed and given to pipeline by chunks,
+		// name of base is given as soon as it's read. Other sections are skipped.
+		// Fields of request are decoded as they come, only nested values are collected
+		class StatHandler final : public json::Handler {
+		public:
+			explicit StatHandler(Pipeline& pipeline) : pipeline_(pipeline) {}
+
+			void StartDict() override {
+				++depth_;
+				CheckLevel(depth_, Kind::Dict);
+				if (IsRequest(depth_)) {
+					query_ = detail::Query{};
+					decoded_.reset();
+					hasKeys_ = false;
+				}
+				else if (IsCollected(depth_)) {
+					GetBuilder().StartDict();
 				}
-				nameBase = query.second.AsDict().at("file").AsString();
 			}
-			else {
-				json::ParsingError("Input data is wrong"s);
+
+			void Key(std::string key) override {
+				if (depth_ == 1) {
+					// of repeated sections the first one is taken as by json::Load,
+					// the rest are skipped
+					section_ = sections_.insert(key).second ? std::move(key) : std::string{};
+				}
+				else if (IsRequest(depth_)) {
+					key_ = std::move(key);
+					hasKeys_ = true;
+				}
+				else if (IsCollected(depth_)) {
+					builder_->Key(std::move(key));
+				}
 			}
-		}
 
-		return { queriesToAdd, queryTowardStop, queriesToBase, routeSettings, nameBase };
-	}
+			void EndDict() override {
+				if (IsRequest(depth_)) {
+					--depth_;
+					// empty request is skipped
+					if (hasKeys_) {
+						AddQuery();
+					}
+					return;
+				}
+				if (IsCollected(depth_)) {
+					builder_->EndDict();
+				}
+				--depth_;
+				TryFinish();
+			}
 
-	json::Document JsonReader::LoadJSON(std::istream & s)
-	{
-		return json::Load(s);
-	}
+			void StartArray() override {
+				++depth_;
+				CheckLevel(depth_, Kind::Array);
+				if (IsCollected(depth_)) {
+					GetBuilder().StartArray();
+				}
+			}
 
-	/*********************************Write******************************/
-	void JsonReader::GetData(std::ostream& output, const handler::RequestHandler& reqHandler,
-		const std::deque<detail::Query> queriesReq)
-	{
-		bool first_printed{ false };
+			void EndArray() override {
+				if (IsCollected(depth_)) {
+					builder_->EndArray();
+				}
+				--depth_;
+				TryFinish();
+			}
 
-		output << "[\n";
+			void Value(json::Node value) override {
+				CheckLevel(depth_ + 1, Kind::Value);
+				if (IsRequest(depth_)) {
+					json::DecodeField(querySchema<json::Node>, key_, value, query_, decoded_);
+				}
+				else if (IsCollected(depth_ + 1)) {
+					GetBuilder().Value(std::move(value));
+					TryFinish();
+				}
+			}
 
-		for (auto& query : queriesReq) {
-			if (first_printed) {
-				output << ",\n";
+			// the last requests which don't fill chunk
+			void Flush() {
+				if (!chunk_.empty()) {
+					pipeline_.Push(std::move(chunk_));
+					chunk_.clear();
+				}
 			}
 
-			if (query.typeOfQuery == "Bus"s) {
-				const auto& stat = reqHandler.GetBusStat(query.nameBus);
-				PrintData(output, stat, query.id_query);
-				first_printed = true;
+		private:
+			enum class Kind { Dict, Array, Value };
+			// level of dicts of requests, 1 is root dict
+			static const std::size_t requestDepth = 3;
+
+			Pipeline& pipeline_;
+			std::size_t depth_ = 0;
+			// key of root dict being read, empty for skipped section
+			std::string section_;
+			std::unordered_set<std::string> sections_;
+			// request being read, its current key and fields already set
+			detail::Query query_;
+			std::string key_;
+			std::bitset<querySchema<json::Node>.size()> decoded_;
+			bool hasKeys_ = false;
+			// nested value of request or settings of serialization
+			std::optional<json::Builder> builder_;
+			std::deque<detail::Query> chunk_;
+
+			// root is dict, stat requests are array of dicts
+			void CheckLevel(std::size_t level, Kind kind) const {
+				const bool isStat = section_ == statReq;
+				if ((level == 1 && kind != Kind::Dict) || (isStat && level == 2 && kind != Kind::Array)
+					|| (isStat && level == requestDepth && kind != Kind::Dict)) {
+					throw json::ParsingError("Input data is wrong"s);
+				}
 			}
-			else if (query.typeOfQuery == "Map"s) {
-				const svg::Document doc = reqHandler.RenderMap();
-				PrintData(output, doc, query.id_query);
-				first_printed = true;
+
+			bool IsRequest(std::size_t level) const {
+				return section_ == statReq && level == requestDepth;
 			}
-			else if (query.typeOfQuery == "Stop"s) {
-				const auto* stop_to_buses = reqHandler.GetBusesByStop(query.nameStop);
-				PrintData(output, stop_to_buses, query.id_query, query.nameStop);
-				first_printed = true;
+
+			bool IsCollected(std::size_t level) const {
+				return level > 1 && ((section_ == statReq && level > requestDepth) || section_ == serialSet);
+			}
+
+			json::Builder& GetBuilder() {
+				if (!builder_) {
+					builder_.emplace();
+				}
+				return *builder_;
+			}
+
+			// handle collected value when it is closed
+			void TryFinish() {
+				if (!builder_ || depth_ != (section_ == statReq ? requestDepth : 1)) {
+					return;
+				}
+				const json::Node value = builder_->Build();
+				builder_.reset();
+
+				if (section_ == statReq) {
+					json::DecodeField(querySchema<json::Node>, key_, value, query_, decoded_);
+				}
+				else if (!(value.IsDict() && value.AsDict().empty())) {
+					pipeline_.SetBase(value.AsDict().at("file").AsString());
+				}
+			}
+
+			void AddQuery() {
+				FinishQuery(query_);
+				chunk_.push_back(std::move(query_));
+				if (chunk_.size() == requestsPerChunk) {
+					Flush();
+				}
+			}
+		};
+	}
+
+	BatchStats JsonReader::ProcessPipelined(std::istream& input, std::ostream& output,
+		const std::function<std::shared_ptr<const snapshot::Snapshot>(const std::string&)>& loadBase,
+		std::size_t threads)
+	{
+		if (binary::IsBinary(input)) {
+			// binary requests are decoded at once, there is little to overlap
+			const auto& [queryAdd, queryTowardStop, queryReq, routeSettings, nameBase] = ReadRequests(input, threads);
+			handler::RequestHandler reqHandler(loadBase(nameBase));
+			return GetData(output, reqHandler, queryReq, threads);
+		}
+
+		Pipeline pipeline(threads * chunksPerThread);
+		std::thread parser([&input, &pipeline] {
+			try {
+				StatHandler handler(pipeline);
+				json::Parse(input, handler);
+				handler.Flush();
+				pipeline.Finish(nullptr);
+			}
+			catch (...) {
+				pipeline.Finish(std::current_exception());
+			}
+		});
+		std::vector<std::thread> workers;
+		const auto join = [&parser, &workers] {
+			parser.join();
+			for (std::thread& worker : workers) {
+				worker.join();
 			}
-			else if (query.typeOfQuery == "Route"s) {
-				PrintData(output, query.from, query.to, reqHandler, query.id_query);
+		};
+
+		// current thread loads base and then writes answers
+		BatchStats stats;
+		try {
+			const handler::RequestHandler reqHandler(loadBase(pipeline.WaitBase()));
+			workers.reserve(threads);
+			for (std::size_t worker = 0; worker < threads; ++worker) {
+				workers.emplace_back([this, &pipeline, &reqHandler, &output] {
+					try {
+						while (auto chunk = pipeline.Pop()) {
+							std::ostringstream stream;
+							stream.precision(output.precision());
+							ChunkAnswer answer;
+							answer.stats = GetData(stream, reqHandler, chunk->second, 1, chunkFraming);
+							answer.text = std::move(stream).str();
+							pipeline.Done(chunk->first, std::move(answer));
+						}
+					}
+					catch (...) {
+						pipeline.Stop(std::current_exception());
+					}
+				});
+			}
+
+			bool first_printed{ false };
+			json::Writer writer(output);
+			writer.Raw(arrayFraming.begin);
+			while (const std::optional<ChunkAnswer> answer = pipeline.Next()) {
+				stats.requests += answer->stats.requests;
+				stats.computed += answer->stats.computed;
+				// chunk of unknown requests only has no answers
+				if (answer->text.empty()) {
+					continue;
+				}
+				if (first_printed) {
+					writer.Raw(arrayFraming.separator);
+				}
+				writer.Raw(answer->text);
 				first_printed = true;
 			}
-			else { continue; }
+			writer.Raw(arrayFraming.end);
+		}
+		catch (...) {
+			// parser ends when input ends, workers end at once
+			pipeline.Stop(std::current_exception());
+			join();
+			throw;
 		}
-		output << "\n]";
+		join();
+		return stats;
 	}
-	
-	void JsonReader::PrintData(std::ostream& output, const std::optional<Stat>& data, const int id_req)
+
+	void JsonReader::PrintAnswer(std::ostream& output, const handler::RequestHandler& reqHandler,
+		const detail::Query& query)
+	{
+		json::Writer writer(output);
+		if (!PrintQuery(writer, reqHandler, BindRequest(query, reqHandler), query, ""sv)) {
+			writer.StartDict()
+				.Key("error_message"sv).Value("unknown request"sv)
+				.Key("request_id"sv).Value(query.id_query)
+				.EndDict();
+		}
+		writer.Raw("\n"sv);
+	}
+
+	bool JsonReader::PrintQuery(json::Writer& writer, const handler::RequestHandler& reqHandler,
+		const detail::StatRequest& request, const detail::Query& query, std::string_view separator)
+	{
+		if (request.type == detail::QueryType::Unknown) {
+			return false;
+		}
+		profile::Scope scope(requestProbes[static_cast<std::size_t>(request.type)]);
+		writer.Raw(separator);
+
+		switch (request.type) {
+		case detail::QueryType::Bus:
+			PrintData(writer, reqHandler.GetBusStat(request.bus), request.id);
+			break;
+		case detail::QueryType::Map:
+			PrintMap(writer, reqHandler.GetMapJson(), request.id);
+			break;
+		case detail::QueryType::Stop:
+			PrintData(writer, reqHandler.GetBusesByStop(request.stop), request.id);
+			break;
+		case detail::QueryType::Route:
+			PrintData(writer, request.stop, request.toStop, reqHandler, request.id);
+			break;
+		case detail::QueryType::NearestStops:
+			PrintData(writer, reqHandler.GetNearestStops({ query.latitude, query.longitude },
+				query.radius, query.limit > 0 ? query.limit : 0), request.id);
+			break;
+		case detail::QueryType::StopSearch:
+			PrintData(writer, reqHandler.SearchStops(query.text,
+				query.maxEdits > 0 ? query.maxEdits : 0, query.limit > 0 ? query.limit : 0), request.id);
+			break;
+		case detail::QueryType::Stats:
+			PrintData(writer, reqHandler.GetMemoryStats(), request.id);
+			break;
+		case detail::QueryType::Unknown:
+			break;
+		}
+		return true;
+	}
+
+	void JsonReader::PrintData(json::Writer& writer, const std::optional<Stat>& data, const int id_req)
 	{
 		if (!(data.has_value())) {
-			json::Node dict_node = json::Builder{}
-				.StartDict()
-				.Key("request_id"s)
-				.Value(id_req)
-				.Key("error_message"s)
-				.Value("not found"s)
-				.EndDict()
-				.Build();
-			output << PrintJSON(dict_node);
+			PrintNotFound(writer, id_req);
 			return;
 		}
 		const auto&[numStops, numUniqueStops, lengthRoute, curvature] = data.value();
 
-		json::Node dict_node = json::Builder{}
-			.StartDict()
-			.Key("request_id"s)
-			.Value(id_req)
-			.Key("curvature"s)
-			.Value(curvature)
-			.Key("route_length"s)
-			.Value(lengthRoute)
-			.Key("stop_count"s)
-			.Value(numStops)
-			.Key("unique_stop_count"s)
-			.Value(numUniqueStops)
-			.EndDict()
-			.Build();
-		output << PrintJSON(dict_node);
-	}
-
-	void JsonReader::PrintData(std::ostream& output, const std::unordered_set<Buses>* data,
-		const int id_req, const std::string_view nameStop) {
-		if (nameStop.empty() || data == nullptr) {
-			json::Node dict_node = json::Builder{}
-				.StartDict()
-				.Key("request_id"s)
-				.Value(id_req)
-				.Key("error_message"s)
-				.Value("not found"s)
-				.EndDict()
-				.Build();
-
-			output << PrintJSON(dict_node);
+		writer.StartDict()
+			.Key("curvature"sv).Value(curvature)
+			.Key("request_id"sv).Value(id_req)
+			.Key("route_length"sv).Value(lengthRoute)
+			.Key("stop_count"sv).Value(numStops)
+			.Key("unique_stop_count"sv).Value(numUniqueStops)
+			.EndDict();
+	}
+
+	void JsonReader::PrintData(json::Writer& writer, const std::optional<StopBuses>& data,
+		const int id_req) {
+		if (!data.has_value()) {
+			PrintNotFound(writer, id_req);
 			return;
 		}
-		else
-		{
-			std::vector<std::string_view> result;
-			std::copy(data->begin(), data->end(), std::back_inserter(result));
-			std::sort(result.begin(), result.end());
-
-			json::Array arr_node;
-			for (auto it = result.begin(); it != result.end(); it++) {
-				json::Node node((std::string)*it);
-				arr_node.push_back(node);
-			}
-			json::Node dict_node = json::Builder{}
-				.StartDict()
-				.Key("request_id"s)
-				.Value(id_req)
-				.Key("buses"s)
-				.Value(arr_node)
-				.EndDict()
-				.Build();
-
-			output << PrintJSON(dict_node);
-			return;
+		// buses are already sorted in catalogue, write them as is
+		writer.StartDict().Key("buses"sv).StartArray();
+		for (const std::string_view nameBus : *data) {
+			writer.Value(nameBus);
 		}
+		writer.EndArray().Key("request_id"sv).Value(id_req).EndDict();
 	}
 
-	void JsonReader::PrintData(std::ostream & output, const svg::Document & doc, const int id_req)
+	void JsonReader::PrintMap(json::Writer& writer, std::string_view mapJson, const int id_req)
 	{
-		std::ostringstream map;
-		doc.Render(map);
-		json::Node dict_node = json::Builder{}
-			.StartDict()
-			.Key("request_id"s)
-			.Value(id_req)
-			.Key("map"s)
-			.Value(map.str())
-			.EndDict()
-			.Build();
-
-		output << PrintJSON(dict_node);
-	}
-
-	void JsonReader::PrintData(std::ostream& output, const std::string& from,
-		const std::string& to, const handler::RequestHandler& reqHandler,
+		writer.StartDict()
+			.Key("map"sv).RawValue(mapJson)
+			.Key("request_id"sv).Value(id_req)
+			.EndDict();
+	}
+
+	void JsonReader::PrintData(json::Writer& writer,
+		const std::vector<std::pair<const domain::Stop*, double>>& stops, const int id_req)
+	{
+		writer.StartDict()
+			.Key("request_id"sv).Value(id_req)
+			.Key("stops"sv).StartArray();
+		for (const auto& [stop, distance] : stops) {
+			writer.StartDict()
+				.Key("distance"sv).Value(distance)
+				.Key("name"sv).Value(stop->nameStop)
+				.EndDict();
+		}
+		writer.EndArray().EndDict();
+	}
+
+	void JsonReader::PrintData(json::Writer& writer, const std::vector<const domain::Stop*>& stops,
 		const int id_req)
 	{
-		const auto& stopIds = reqHandler.GetRouter().GetMakedGraph().GetStopIds();
-		if (!(stopIds.count(from) && stopIds.count(to))) {
-			json::Node dict_node = json::Builder{}
-				.StartDict()
-				.Key("request_id"s)
-				.Value(id_req)
-				.Key("error_message"s)
-				.Value("not found"s)
-				.EndDict()
-				.Build();
-			output << PrintJSON(dict_node);
+		writer.StartDict()
+			.Key("request_id"sv).Value(id_req)
+			.Key("stops"sv).StartArray();
+		for (const domain::Stop* stop : stops) {
+			writer.Value(stop->nameStop);
+		}
+		writer.EndArray().EndDict();
+	}
+
+	void JsonReader::PrintData(json::Writer& writer, const memory::Report& report, const int id_req)
+	{
+		writer.StartDict()
+			.Key("request_id"sv).Value(id_req)
+			.Key("structures"sv).StartArray();
+		for (const memory::Item& item : report.GetItems()) {
+			writer.StartDict()
+				.Key("allocated"sv).Value(item.allocated)
+				.Key("bytes"sv).Value(item.bytes)
+				.Key("items"sv).Value(item.count)
+				.Key("name"sv).Value(item.name)
+				.EndDict();
+		}
+		writer.EndArray()
+			.Key("total_allocated"sv).Value(report.GetTotalAllocated())
+			.Key("total_bytes"sv).Value(report.GetTotalBytes())
+			.EndDict();
+	}
+
+	void JsonReader::PrintData(json::Writer& writer, const domain::Stop* from,
+		const domain::Stop* to, const handler::RequestHandler& reqHandler,
+		const int id_req)
+	{
+		const std::optional<graph::VertexId> fromVertId = reqHandler.GetStopVertex(from);
+		const std::optional<graph::VertexId> toVertId = reqHandler.GetStopVertex(to);
+		if (!(fromVertId && toVertId)) {
+			PrintNotFound(writer, id_req);
 			return;
 		}
 	
-		const size_t fromVertId = stopIds.at(from);
-		const size_t toVertId = stopIds.at(to);
-		const std::optional<Route>& data = reqHandler.GetRouter().GetPtrRoute().get()->BuildRoute(fromVertId, toVertId);
+		const std::optional<Route>& data = reqHandler.GetRouter().BuildRoute(*fromVertId, *toVertId);
 		if (!(data.has_value())) {
-			json::Node dict_node = json::Builder{}
-				.StartDict()
-				.Key("request_id"s)
-				.Value(id_req)
-				.Key("error_message"s)
-				.Value("not found"s)
-				.EndDict()
-				.Build();
-			output << PrintJSON(dict_node);
+			PrintNotFound(writer, id_req);
 			return;
 		}
 	
 		const auto& graph = reqHandler.GetRouter().GetMakedGraph().GetGraph();
-		
-		json::Node dict_node = json::Builder{}
-			.StartDict()
-			.Key("items"s)
-			.Value(GetEdges(data->edges, graph))
-			.Key("total_time"s)
-			.Value(data->weight)
-			.Key("request_id"s)
-			.Value(id_req)
-			.EndDict()
-			.Build();		
-		output << PrintJSON(dict_node);
-	}
-
-	std::string JsonReader::PrintJSON(const json::Node & node)
-	{
-		std::ostringstream out;
-		Print(json::Document{ node }, out);
-		return out.str();
-	}
-	json::Node JsonReader::GetEdges(const std::vector<graph::EdgeId>& edges,
-		const graph::DirectedWeightedGraph<double>& graph) const
-	{
-		json::Array items;
-		items.reserve(edges.size());
-		for (const auto& edgeId : edges){
+
+		writer.StartDict().Key("items"sv).StartArray();
+		for (const auto& edgeId : data->edges) {
 			const graph::Edge<double>& edge = graph.GetEdge(edgeId);
 			if (edge.span_count == 0) {
-				items.emplace_back(
-					json::Builder{}
-					.StartDict()
-					.Key("type"s).Value("Wait"s)
-					.Key("stop_name"s).Value(edge.name)
-					.Key("time"s).Value(edge.weight)
-					.EndDict()
-					.Build()
-				);
+				writer.StartDict()
+					.Key("stop_name"sv).Value(edge.name)
+					.Key("time"sv).Value(edge.weight)
+					.Key("type"sv).Value("Wait"sv)
+					.EndDict();
 			}
 			else {
-				items.emplace_back(
-					json::Builder{}
-					.StartDict()
-					.Key("type"s).Value("Bus"s)
-					.Key("bus"s).Value(edge.name)
-					.Key("span_count"s).Value((int)edge.span_count)
-					.Key("time"s).Value(edge.weight)
-					.EndDict()
-					.Build()
-				);
-			}
-		}
-		return items;
+				writer.StartDict()
+					.Key("bus"sv).Value(edge.name)
+					.Key("span_count"sv).Value(static_cast<int>(edge.span_count))
+					.Key("time"sv).Value(edge.weight)
+					.Key("type"sv).Value("Bus"sv)
+					.EndDict();
+			}
+		}
+		writer.EndArray()
+			.Key("request_id"sv).Value(id_req)
+			.Key("total_time"sv).Value(data->weight)
+			.EndDict();
+	}
+
+	void JsonReader::PrintNotFound(json::Writer& writer, const int id_req)
+	{
+		writer.StartDict()
+			.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(id_req)
+			.EndDict();
 	}
 }
\ No newline at end of file
@@ -4,15 +4,41 @@
 #include "request_handler.h"
 
 #include "json.h"
+#include "json_writer.h"
+#include "thread_pool.h"
 
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace reader 
 {
 	namespace detail 
 	{
+		// kinds of stat requests, type is recognized once when request is read
+		enum class QueryType : std::uint8_t {
+			Unknown,
+			Bus,
+			Stop,
+			Route,
+			Map,
+			NearestStops,
+			StopSearch,
+			Stats,
+		};
+
+		// type of stat request by its name, Unknown for other names
+		QueryType GetQueryType(std::string_view name);
+
 		struct Query {
 			std::string typeOfQuery;
+			QueryType type{ QueryType::Unknown };
 			std::string nameStop;
 			double latitude{ 0.0 };
 			double longitude{ 0.0 };
@@ -22,6 +48,23 @@ namespace reader
 			int id_query{ 0 };
 			std::string from;
 			std::string to;
+			double radius{ 0.0 };
+			int limit{ 0 };
+			std::string text;
+			int maxEdits{ 0 };
+		};
+
+		// stat request bound to version of catalogue: names are resolved once before
+		// requests are answered, other parameters are taken from its Query
+		struct StatRequest {
+			QueryType type{ QueryType::Unknown };
+			int id{ 0 };
+			// bus of Bus request
+			const domain::Bus* bus{ nullptr };
+			// stop of Stop request, the first stop of Route request
+			const domain::Stop* stop{ nullptr };
+			// the last stop of Route request
+			const domain::Stop* toStop{ nullptr };
 		};
 
 		struct Distance {
@@ -33,6 +76,25 @@ namespace reader
 			double velocity;
 			int waitTime;
 		};
+
+		// data of base ready to load into catalogue, each name is kept once
+		// and all records refer to it, so the structure must not be copied
+		struct BaseData {
+			std::unordered_set<std::string> names;
+			std::vector<tc::StopData> stops;
+			std::vector<tc::DistanceData> distances;
+			std::vector<tc::BusData> buses;
+			RouteSet routeSettings{};
+			std::string nameBase;
+		};
+
+		// changes of base read from update_requests: records the same as in base and
+		// names of removed stops and buses, all names are kept in base.names
+		struct UpdateData {
+			BaseData base;
+			std::vector<std::string_view> removedStops;
+			std::vector<std::string_view> removedBuses;
+		};
 	}
 
 	using ResponseAddQuery = std::deque<detail::Query>;
@@ -42,42 +104,105 @@ namespace reader
 		std::deque<detail::Query>, detail::RouteSet, std::string>;
 	using ResponseRoute = std::tuple<std::vector<std::string>, bool>;
 	using Stat = handler::BusStat;
-	using Buses = handler::BusPtr;
+	using StopBuses = tc::StopBuses;
 	using Route = graph::Router<double>::RouteInfo;
 	using namespace std::literals;
 
+	// text written around answers of requests
+	struct Framing {
+		std::string_view begin;
+		std::string_view separator;
+		std::string_view end;
+	};
+	// answers of process_requests, one per line
+	inline constexpr Framing arrayFraming{ "[\n"sv, ",\n"sv, "\n]"sv };
+	// the same array in one line, it ends by line break
+	inline constexpr Framing lineFraming{ "["sv, ", "sv, "]\n"sv };
+
+	// requests of batch and answers computed for them, copies of the same
+	// request share one answer
+	struct BatchStats {
+		std::size_t requests = 0;
+		std::size_t computed = 0;
+	};
+
 	class JsonReader {
 	public:
 		JsonReader() = default;
 
-		ResponseData ReadData(std::istream& input, renderer::Settings& setup);
+		// large sections of document are parsed by up to threads threads
+		ResponseData ReadData(std::istream& input, renderer::Settings& setup, std::size_t threads = 1);
+		// reads input for process_requests: only stat requests and name of base
+		// are parsed, other sections come from base and are skipped. If update is
+		// given, changes of base in update_requests are read into it
+		ResponseData ReadRequests(std::istream& input, std::size_t threads = 1,
+			detail::UpdateData* update = nullptr);
+		// reads input for make_base, requests of base are converted one by one
+		// while they are parsed, document is never kept whole
+		detail::BaseData ReadBase(std::istream& input, renderer::Settings& setup);
+		// reads one stat request given alone, as line of NDJSON stream, empty
+		// request is error. Memory of previous request is reused
+		detail::Query ReadQuery(std::string text);
 
-		void GetData(std::ostream& output, const handler::RequestHandler& reqHandler,
-			const std::deque<detail::Query> queriesReq);
+		// requests are answered by up to threads threads of pool kept between batches,
+		// answers are written in order of requests.
+		// Requests differing by id only are answered once, their answers are copied
+		BatchStats GetData(std::ostream& output, const handler::RequestHandler& reqHandler,
+			const std::deque<detail::Query>& queriesReq, std::size_t threads = 1,
+			const Framing& framing = arrayFraming);
+		// process_requests by stages running at once: parser thread reads stat requests
+		// by chunks, threads workers answer them as soon as base is loaded by loadBase,
+		// current thread writes answers in order. Copies of request are answered once
+		// if they are in the same chunk
+		BatchStats ProcessPipelined(std::istream& input, std::ostream& output,
+			const std::function<std::shared_ptr<const snapshot::Snapshot>(const std::string&)>& loadBase,
+			std::size_t threads);
+		// answer of one request in one line, request of unknown type is answered
+		// by error, so each request gets its line
+		void PrintAnswer(std::ostream& output, const handler::RequestHandler& reqHandler,
+			const detail::Query& query);
 
 	private:
+		class BaseHandler;
+
+		// document of the last request read by ReadQuery
+		json::ArenaDocument queryDoc_;
+		// threads of GetData, started by the first parallel batch
+		std::unique_ptr<pool::ThreadPool> pool_;
+
+		// pool is started again only if number of threads changes
+		pool::ThreadPool& GetPool(std::size_t threads);
+
 		std::vector<std::string> GetStopsRoute(json::Node& input);
 		std::vector<detail::Distance> GetStopsDistance(json::Node& input);
 		ResponseAddQuery ReadAddQuery(const json::Node& input);
 		ResponseAddTowardStop ReadAddTowardStop(const json::Node& input);
-		std::deque<detail::Query> ReadGetQuery(const json::Node& input);
+		void ReadBaseRequest(const json::Dict& request, detail::BaseData& base);
+		// request of base or removal of stop or bus marked by "removed": true
+		void ReadUpdateRequest(const json::Dict& request, detail::UpdateData& update);
+		std::deque<detail::Query> ReadGetQuery(const json::NodeView input);
 		void ReadRenderQuery(const json::Dict& input, renderer::Settings& setup);
+		void ReadRenderQuery(const json::DictView input, renderer::Settings& setup);
 		detail::RouteSet ReadRoutingQuery(const json::Dict& input);
-		json::Document LoadJSON(std::istream& s);
+		detail::RouteSet ReadRoutingQuery(const json::DictView input);
 
-		void PrintData(std::ostream& output, const std::optional<Stat>& data, const int id_req);
-		void PrintData(std::ostream& output, const std::unordered_set<Buses>* data,
-			const int id_req, const std::string_view nameStop);
-		void PrintData(std::ostream& output, const svg::Document& doc,
+		// answer preceded by separator, false if type of request is unknown,
+		// then nothing is written
+		bool PrintQuery(json::Writer& writer, const handler::RequestHandler& reqHandler,
+			const detail::StatRequest& request, const detail::Query& query, std::string_view separator);
+		void PrintData(json::Writer& writer, const std::optional<Stat>& data, const int id_req);
+		void PrintData(json::Writer& writer, const std::optional<StopBuses>& data, const int id_req);
+		// map is given as JSON string made by RequestHandler
+		void PrintMap(json::Writer& writer, std::string_view mapJson, const int id_req);
+		void PrintData(json::Writer& writer, const std::vector<std::pair<const domain::Stop*, double>>& stops,
 			const int id_req);
-		void PrintData(std::ostream& output, const std::string& from,
-			const std::string& to, const handler::RequestHandler& reqHandler,
+		void PrintData(json::Writer& writer, const std::vector<const domain::Stop*>& stops,
 			const int id_req);
-		
-		std::string PrintJSON(const json::Node & node);
-
-		json::Node GetEdges(const std::vector<graph::EdgeId>& edges,
-			const graph::DirectedWeightedGraph<double>& graph) const;
+		void PrintData(json::Writer& writer, const memory::Report& report, const int id_req);
+		void PrintData(json::Writer& writer, const domain::Stop* from,
+			const domain::Stop* to, const handler::RequestHandler& reqHandler,
+			const int id_req);
+		void PrintNotFound(json::Writer& writer, const int id_req);
 	};
 }
 
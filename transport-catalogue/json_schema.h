@@ -0,0 +1,130 @@
+#pragma once
+#include "json.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace json {
+	// decoder of value of one key into part of T. NodeT is json::Node or json::NodeView
+	template <typename T, typename NodeT>
+	struct Field {
+		std::string_view key;
+		void (*decode)(const NodeT& value, T& target);
+	};
+
+	// fields must be sorted by key, it is checked by IsSorted at compile time
+	template <typename T, typename NodeT, std::size_t N>
+	using Schema = std::array<Field<T, NodeT>, N>;
+
+	namespace detail {
+		template <typename Member>
+		struct MemberOf;
+
+		template <typename Class, typename Value>
+		struct MemberOf<Value Class::*> {
+			using Type = Class;
+		};
+
+		template <typename>
+		struct DependentFalse : std::false_type {};
+	}
+
+	// value is taken only if node has suitable type, otherwise target is kept
+	template <typename NodeT, typename V>
+	void DecodeValue(const NodeT& node, V& target) {
+		if constexpr (std::is_same_v<V, int>) {
+			if (node.IsInt()) {
+				target = node.AsInt();
+			}
+		}
+		else if constexpr (std::is_same_v<V, double>) {
+			if (node.IsDouble()) {
+				target = node.AsDouble();
+			}
+		}
+		else if constexpr (std::is_same_v<V, bool>) {
+			if (node.IsBool()) {
+				target = node.AsBool();
+			}
+		}
+		else if constexpr (std::is_same_v<V, std::string>) {
+			if (node.IsString()) {
+				target = node.AsString();
+			}
+		}
+		else if constexpr (std::is_same_v<V, std::vector<double>>) {
+			if (node.IsArray()) {
+				for (const auto& element : node.AsArray()) {
+					if (element.IsDouble()) {
+						target.push_back(element.AsDouble());
+					}
+				}
+			}
+		}
+		else {
+			static_assert(detail::DependentFalse<V>::value, "no decoder for type of member");
+		}
+	}
+
+	template <auto Member, typename NodeT>
+	void DecodeMember(const NodeT& node, typename detail::MemberOf<decltype(Member)>::Type& target) {
+		DecodeValue(node, target.*Member);
+	}
+
+	// field decoding value into data member
+	template <typename NodeT, auto Member>
+	constexpr Field<typename detail::MemberOf<decltype(Member)>::Type, NodeT> MakeField(std::string_view key) {
+		return { key, &DecodeMember<Member, NodeT> };
+	}
+
+	template <typename T, typename NodeT, std::size_t N>
+	constexpr bool IsSorted(const Schema<T, NodeT, N>& schema) {
+		for (std::size_t i = 1; i < N; ++i) {
+			if (!(schema[i - 1].key < schema[i].key)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// keys of dict and of schema are both sorted, so they are matched in one pass,
+	// keys out of schema are skipped
+	template <typename DictT, typename T, typename NodeT, std::size_t N>
+	void Decode(const DictT& dict, const Schema<T, NodeT, N>& schema, T& target) {
+		auto field = schema.begin();
+		for (const auto& [key, value] : dict) {
+			while (field != schema.end() && field->key < key) {
+				++field;
+			}
+			if (field == schema.end()) {
+				return;
+			}
+			if (field->key == key) {
+				field->decode(value, target);
+			}
+		}
+	}
+
+	// value of one key of dict, for values given one by one while they are parsed.
+	// Fields marked in decoded are skipped, so of repeated keys the first one is
+	// taken as by Decode
+	template <typename T, typename NodeT, std::size_t N>
+	void DecodeField(const Schema<T, NodeT, N>& schema, std::string_view key, const NodeT& value, T& target,
+		std::bitset<N>& decoded) {
+		const auto field = std::lower_bound(schema.begin(), schema.end(), key,
+			[](const Field<T, NodeT>& lhs, std::string_view rhs) { return lhs.key < rhs; });
+		if (field == schema.end() || field->key != key) {
+			return;
+		}
+		const std::size_t index = static_cast<std::size_t>(field - schema.begin());
+		if (!decoded[index]) {
+			decoded[index] = true;
+			field->decode(value, target);
+		}
+	}
+}
@@ -0,0 +1,252 @@
+#include "json_writer.h"
+#include "format.h"
+
+#include <charconv>
+#include <stdexcept>
+
+using namespace std::literals;
+
+namespace json {
+	namespace {
+		const std::size_t bufferSize = 1 << 16;
+	}
+
+	// stream buffer escaping everything written into it
+	class Writer::EscapeBuffer : public std::streambuf {
+	public:
+		explicit EscapeBuffer(Writer& writer) : writer_(writer) {}
+
+	protected:
+		int_type overflow(int_type ch) override {
+			if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+				const char symbol = traits_type::to_char_type(ch);
+				writer_.PutEscaped({ &symbol, 1 });
+			}
+			return traits_type::not_eof(ch);
+		}
+
+		std::streamsize xsputn(const char* text, std::streamsize size) override {
+			writer_.PutEscaped({ text, static_cast<std::size_t>(size) });
+			return size;
+		}
+
+	private:
+		Writer& writer_;
+	};
+
+	Writer::Writer(std::ostream& output)
+		: output_(output), precision_(static_cast<int>(output.precision()))
+	{
+		buffer_.reserve(bufferSize);
+	}
+
+	Writer::~Writer()
+	{
+		Flush();
+	}
+
+	Writer& Writer::StartDict()
+	{
+		BeforeValue();
+		Put('{');
+		empty_.push_back(true);
+		return *this;
+	}
+
+	Writer& Writer::Key(std::string_view key)
+	{
+		if (afterKey_) {
+			throw std::logic_error("The command \"Key\" was called in wrong place"s);
+		}
+		BeforeValue();
+		Put('"');
+		PutEscaped(key);
+		Put("\": "sv);
+		afterKey_ = true;
+		return *this;
+	}
+
+	Writer& Writer::EndDict()
+	{
+		if (empty_.empty() || afterKey_) {
+			throw std::logic_error("The command \"EndDict\" was called in wrong place"s);
+		}
+		empty_.pop_back();
+		Put('}');
+		return *this;
+	}
+
+	Writer& Writer::StartArray()
+	{
+		BeforeValue();
+		Put('[');
+		empty_.push_back(true);
+		return *this;
+	}
+
+	Writer& Writer::EndArray()
+	{
+		if (empty_.empty() || afterKey_) {
+			throw std::logic_error("The command \"EndArray\" was called in wrong place"s);
+		}
+		empty_.pop_back();
+		Put(']');
+		return *this;
+	}
+
+	Writer& Writer::Value(std::nullptr_t)
+	{
+		BeforeValue();
+		Put(NoneData);
+		return *this;
+	}
+
+	Writer& Writer::Value(bool value)
+	{
+		BeforeValue();
+		Put(value ? "true"sv : "false"sv);
+		return *this;
+	}
+
+	Writer& Writer::Value(int value)
+	{
+		BeforeValue();
+		char text[16];
+		const auto result = std::to_chars(std::begin(text), std::end(text), value);
+		Put({ text, static_cast<std::size_t>(result.ptr - text) });
+		return *this;
+	}
+
+	Writer& Writer::Value(std::size_t value)
+	{
+		BeforeValue();
+		char text[24];
+		const auto result = std::to_chars(std::begin(text), std::end(text), value);
+		Put({ text, static_cast<std::size_t>(result.ptr - text) });
+		return *this;
+	}
+
+	Writer& Writer::Value(double value)
+	{
+		BeforeValue();
+		format::DoubleBuffer text;
+		Put(format::FormatDouble(value, precision_, text));
+		return *this;
+	}
+
+	Writer& Writer::Value(std::string_view value)
+	{
+		BeforeValue();
+		Put('"');
+		PutEscaped(value);
+		Put('"');
+		return *this;
+	}
+
+	Writer& Writer::Value(const char* value)
+	{
+		return Value(std::string_view(value));
+	}
+
+	Writer& Writer::StringValue(const std::function<void(std::ostream&)>& write)
+	{
+		BeforeValue();
+		Put('"');
+		EscapeBuffer escape(*this);
+		std::ostream stream(&escape);
+		write(stream);
+		Put('"');
+		return *this;
+	}
+
+	Writer& Writer::RawValue(std::string_view json)
+	{
+		BeforeValue();
+		Put(json);
+		return *this;
+	}
+
+	Writer& Writer::Raw(std::string_view text)
+	{
+		Put(text);
+		return *this;
+	}
+
+	void Writer::Flush()
+	{
+		if (!buffer_.empty()) {
+			output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+			buffer_.clear();
+		}
+	}
+
+	void Writer::BeforeValue()
+	{
+		if (afterKey_) {
+			afterKey_ = false;
+			return;
+		}
+		if (!empty_.empty()) {
+			if (!empty_.back()) {
+				Put(", "sv);
+			}
+			empty_.back() = false;
+		}
+	}
+
+	void Writer::Put(char ch)
+	{
+		buffer_.push_back(ch);
+		FlushIfFull();
+	}
+
+	void Writer::Put(std::string_view text)
+	{
+		// large text like cached map goes to stream without copy to buffer
+		if (text.size() >= bufferSize) {
+			Flush();
+			output_.write(text.data(), static_cast<std::streamsize>(text.size()));
+			return;
+		}
+		buffer_.append(text);
+		FlushIfFull();
+	}
+
+	// escaped like PrintString does
+	void Writer::PutEscaped(std::string_view text)
+	{
+		std::size_t begin = 0;
+		for (std::size_t i = 0; i < text.size(); ++i) {
+			char escaped;
+			switch (text[i]) {
+			case '"':
+				escaped = '"';
+				break;
+			case '\\':
+				escaped = '\\';
+				break;
+			case '\n':
+				escaped = 'n';
+				break;
+			case '\r':
+				escaped = 'r';
+				break;
+			default:
+				continue;
+			}
+			buffer_.append(text.substr(begin, i - begin));
+			buffer_.push_back('\\');
+			buffer_.push_back(escaped);
+			begin = i + 1;
+		}
+		buffer_.append(text.substr(begin));
+		FlushIfFull();
+	}
+
+	void Writer::FlushIfFull()
+	{
+		if (buffer_.size() >= bufferSize) {
+			Flush();
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "json.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+	// writes document straight to stream while it is described, without nodes.
+	// Layout is the same as of Print. Text is collected in own buffer which is
+	// flushed when it is full, by Flush and on destruction
+	class Writer {
+	public:
+		explicit Writer(std::ostream& output);
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+		~Writer();
+
+		Writer& StartDict();
+		Writer& Key(std::string_view key);
+		Writer& EndDict();
+		Writer& StartArray();
+		Writer& EndArray();
+
+		Writer& Value(std::nullptr_t);
+		Writer& Value(bool value);
+		Writer& Value(int value);
+		Writer& Value(std::size_t value);
+		Writer& Value(double value);
+		Writer& Value(std::string_view value);
+		Writer& Value(const char* value);
+		// string made by callback through stream, it is escaped on the fly
+		Writer& StringValue(const std::function<void(std::ostream&)>& write);
+
+		// value given as ready JSON text, like string escaped beforehand
+		Writer& RawValue(std::string_view json);
+		// text put between values as is, syntax is kept by caller
+		Writer& Raw(std::string_view text);
+		void Flush();
+
+	private:
+		class EscapeBuffer;
+
+		std::ostream& output_;
+		std::string buffer_;
+		// for each open container: nothing is written into it yet
+		std::vector<bool> empty_;
+		bool afterKey_ = false;
+		int precision_;
+
+		void BeforeValue();
+		void Put(char ch);
+		void Put(std::string_view text);
+		void PutEscaped(std::string_view text);
+		void FlushIfFull();
+	};
+}
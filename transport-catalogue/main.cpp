@@ -1,128 +1,354 @@
 #include "serialization.h"
 #include "map_renderer.h"
 #include "json_reader.h"
+#include "binary_input.h"
 #include "request_handler.h"
 
 #include "graph.h"
 #include "router.h"
 #include "transport_router.h"
+#include "snapshot.h"
+#include "profile.h"
 
+#include <charconv>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <string_view>
 #include <filesystem>
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base [--prerender]|process_requests [--stats] [--pipeline]|"sv
+        << "serve|stream FILE|encode_requests] [--threads N] [--profile] [--trace FILE]\n"sv;
+}
+
+// stages of modes timed by --profile and --trace, requests are timed by JsonReader
+namespace {
+	profile::Probe parseProbe{ "parse"sv };
+	profile::Probe readBaseProbe{ "read base"sv };
+	profile::Probe loadCatalogueProbe{ "load catalogue"sv };
+	profile::Probe buildGraphProbe{ "build graph"sv };
+	profile::Probe buildRouterProbe{ "build router"sv };
+	profile::Probe answerProbe{ "answer batch"sv };
+	profile::Probe saveBaseProbe{ "save base"sv };
+	profile::Probe updateProbe{ "update base"sv };
+}
+
+// answer of request which can't be read or answered, one line as answers of serve
+void PrintError(std::ostream& output, const std::exception& error) {
+	json::Writer writer(output);
+	writer.StartDict().Key("error_message"sv).Value(std::string_view(error.what())).EndDict();
+	writer.Raw("\n"sv);
+}
+
+// memory of structures and repeated requests of batch, for --stats
+void PrintBatchStats(const handler::RequestHandler& reqHandler, const reader::BatchStats& batch) {
+	memory::PrintReport(reqHandler.GetMemoryStats(), std::cerr);
+	std::cerr << "requests: "sv << batch.requests << ", computed: "sv << batch.computed
+		<< ", dedup ratio: "sv << (batch.computed == 0 ? 1.0
+			: static_cast<double>(batch.requests) / batch.computed) << '\n';
+}
+
+// base saved by make_base, settings of renderer are taken from it too
+// statistics of buses are computed by up to threads threads
+std::shared_ptr<const snapshot::Snapshot> LoadBase(const std::filesystem::path& path, std::size_t threads) {
+	renderer::Settings settings;
+	profile::Scope readScope(readBaseProbe);
+	std::optional<transport_catalogue_serialize::TCFull> tc_full = serialization::Deserelization(path);
+	if (!tc_full) {
+		throw std::runtime_error("Can't read base "s + path.string());
+	}
+
+	// make deserilization for trasport catalog
+	std::optional<transport_catalogue_serialize::TC> deserializedTC = serialization::DeserelizationTC(tc_full);
+	// make deserilization for renderer settings
+	std::optional<render_settings_serialize::RenderSet> deserializedRenderer = serialization::DeserelizationRenderer(tc_full);
+	// make deserelization for router
+	std::optional<router_serialize::Router> deserializedRouter = serialization::DeserelizationRouter(tc_full);
+	readScope.Close();
+	// declare transport catalogue object
+	auto catalogue_db = std::make_shared<tc::TransportCatalogue>();
+	catalogue_db->SetThreads(threads);
+	// make initialization transport catalog object by means db from file
+	profile::Scope catalogueScope(loadCatalogueProbe);
+	serialization::InitiliaziationTransportCatalogue(deserializedTC, *catalogue_db);
+	catalogueScope.Close();
+
+	// getting render settings by means db from file
+	serialization::InitializationRenderSettings(deserializedRenderer, settings);
+
+	// declare transport graph
+	auto tr_db = std::make_shared<graph::TransportGraph>();
+	// make initialization graph by means db from file
+	profile::Scope graphScope(buildGraphProbe);
+	serialization::InitializationRouter(deserializedRouter, *tr_db);
+	tr_db->BindStops(*catalogue_db);
+	graphScope.Close();
+	// map rendered by make_base, if any
+	std::string map = std::move(*tc_full->mutable_map());
+	// messages of base are not needed anymore
+	deserializedTC.reset();
+	deserializedRenderer.reset();
+	deserializedRouter.reset();
+	tc_full.reset();
+
+	// loaded base is the first version, renderer and router are made for it
+	return snapshot::MakeSnapshot(catalogue_db, tr_db, settings, std::move(map));
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
+    // report memory taken by structures after answering requests
+    bool printStats = false;
+    // requests are parsed and answered, statistics of buses are computed by this number of threads
+    std::size_t threads = 1;
+    // map is rendered by make_base and saved in base
+    bool prerender = false;
+    // process_requests parses, answers and writes at once
+    bool pipelined = false;
+    // latency of stages and requests is printed to stderr at exit
+    bool profiling = false;
+    // timed scopes are written to file in Chrome trace format
+    std::filesystem::path tracePath;
+    // the only argument of stream is file of base
+    const bool isStream = mode == "stream"sv;
+    if (isStream && argc < 3) {
+        PrintUsage();
+        return 1;
+    }
+    for (int i = isStream ? 3 : 2; i < argc; ++i) {
+        const std::string_view option(argv[i]);
+        if (option == "--profile"sv) {
+            profiling = true;
+            continue;
+        }
+        if (option == "--trace"sv && i + 1 < argc) {
+            tracePath = argv[++i];
+            continue;
+        }
+        if (option == "--prerender"sv && mode == "make_base"sv) {
+            prerender = true;
+            continue;
+        }
+        if (isStream) {
+            PrintUsage();
+            return 1;
+        }
+        if (option == "--stats"sv && mode == "process_requests"sv) {
+            printStats = true;
+            continue;
+        }
+        if (option == "--pipeline"sv && mode == "process_requests"sv) {
+            pipelined = true;
+            continue;
+        }
+        if (option != "--threads"sv || i + 1 == argc) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string_view value(argv[++i]);
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), threads);
+        if (ec != std::errc{} || ptr != value.data() + value.size() || threads == 0) {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (profiling || !tracePath.empty()) {
+        profile::Enable(!tracePath.empty());
+    }
 
     if (mode == "make_base"sv) {
 
 		// create Setting object
 		renderer::Settings settings;
 		reader::JsonReader jr;
-		const auto& [queryAdd, queryTowardStop, queryReq, routeSettings, nameBase] = jr.ReadData(std::cin, settings);
-		// declare transport catalogue object
+		// stops, distances and routes are collected while input is parsed
+		profile::Scope parseScope(parseProbe);
+		const reader::detail::BaseData base = jr.ReadBase(std::cin, settings);
+		parseScope.Close();
+		const auto& routeSettings = base.routeSettings;
+		const auto& nameBase = base.nameBase;
+		// declare transport catalogue object and load all data at once
+		profile::Scope catalogueScope(loadCatalogueProbe);
 		tc::TransportCatalogue catalogue;
-		// threading queries to add stop
-		for (auto& query : queryAdd) {
-			if (query.typeOfQuery == "Stop"s) {
-				catalogue.AddStopToBase(query.nameStop, query.latitude, query.longitude);
-			}
-		}
-		// threading queries to add stop distances
-		for (auto& query : queryTowardStop) {
-			for (auto& [from, vec_to] : query) {
-				// get ptr to head stop
-				const domain::Stop* ptr_from = catalogue.SearchStop(from);
-				//get ptr for stop from head
-				// and set distance in transport catalogue
-				for (const auto& data : vec_to) {
-					// set distance
-					const domain::Stop* ptr_to = catalogue.SearchStop(data.to);
-					catalogue.SetDistanceBetweenStops(std::make_pair(ptr_from, ptr_to), data.distance);
-				}
-			}
-		} // end thereading queries
-		// threading queries to add route
-		for (auto& query : queryAdd) {
-			if (query.typeOfQuery == "Bus"s) {
-				catalogue.AddRouteToBase(query.nameBus, query.routeStops, query.isRing);
-			}
-		}
+		catalogue.SetThreads(threads);
+		catalogue.LoadBase(base.stops, base.distances, base.buses);
+		catalogue.BuildSpatialIndex();
+		catalogueScope.Close();
 
 		// fill transport graph
+		profile::Scope graphScope(buildGraphProbe);
 		graph::TransportGraph tr(catalogue, routeSettings.velocity, routeSettings.waitTime);
+		graphScope.Close();
 
 		// init router by graph
+		profile::Scope routerScope(buildRouterProbe);
 		graph::TransportRouter rdb(tr);
+		routerScope.Close();
 
 		const std::filesystem::path path = nameBase;
 
+		render_settings_serialize::RenderSet renderSet = serialization::CreateRenderer(settings);
+		// Map requests of process_requests take it as is, so it's rendered
+		// by settings the same as process_requests reads from base
+		std::string map;
+		if (prerender) {
+			renderer::Settings savedSettings;
+			serialization::InitializationRenderSettings(renderSet, savedSettings);
+			map = handler::RenderMapJson(catalogue, *snapshot::MakeRenderer(catalogue, savedSettings));
+		}
+
+		profile::Scope saveScope(saveBaseProbe);
 		serialization::SerilalizeData(path,
 			serialization::CreateTC(catalogue),
-			serialization::CreateRenderer(settings),
-			serialization::CreateRouter(rdb, routeSettings.waitTime, routeSettings.velocity));
+			renderSet,
+			serialization::CreateRouter(rdb, routeSettings.waitTime, routeSettings.velocity),
+			map);
+
+    } else if (mode == "process_requests"sv && pipelined) {
+
+		// requests are answered while the rest of them are parsed, base is loaded
+		// as soon as its name is read
+		reader::JsonReader jr;
+		std::shared_ptr<const snapshot::Snapshot> base;
+		profile::Scope answerScope(answerProbe);
+		const reader::BatchStats batch = jr.ProcessPipelined(std::cin, std::cout,
+			[&base, threads](const std::string& name) {
+				base = LoadBase(name, threads);
+				return base;
+			}, threads);
+		answerScope.Close();
+
+		if (printStats) {
+			PrintBatchStats(handler::RequestHandler(base), batch);
+		}
 
     } else if (mode == "process_requests"sv) {
 
-		// declare Setting object
-		renderer::Settings settings;
 		reader::JsonReader jr;
-		const auto& [queryAdd, queryTowardStop, queryReq, routeSettings, nameBase] = jr.ReadData(std::cin, settings);
+		// everything but stat requests is taken from base
+		profile::Scope parseScope(parseProbe);
+		const auto& [queryAdd, queryTowardStop, queryReq, routeSettings, nameBase] = jr.ReadRequests(std::cin, threads);
+		parseScope.Close();
 		// assign name for path to database
 		const std::filesystem::path path = nameBase;
 
-		std::optional<transport_catalogue_serialize::TCFull> tc_full = serialization::Deserelization(path);
-
-		// make deserilization for trasport catalog
-		std::optional<transport_catalogue_serialize::TC> deserializedTC = serialization::DeserelizationTC(tc_full);
-		// make deserilization for renderer settings
-		std::optional<render_settings_serialize::RenderSet> deserializedRenderer = serialization::DeserelizationRenderer(tc_full);
-		// make deserelization for router
-		std::optional<router_serialize::Router> deserializedRouter = serialization::DeserelizationRouter(tc_full);
-		// declare transport catalogue object
-		tc::TransportCatalogue catalogue_db;
-		// make initialization transport catalog object by means db from file
-		serialization::InitiliaziationTransportCatalogue(deserializedTC, catalogue_db);
-
-		// getting render settings by means db from file
-		serialization::InitializationRenderSettings(deserializedRenderer, settings);
-
-		// declare transport graph
-		graph::TransportGraph tr_db;
-		// make initialization graph by means db from file
-		serialization::InitializationRouter(deserializedRouter, tr_db);
-
-		// define init data for renderer
-		const auto& stops = catalogue_db.GetSortedStops();
-		// initiliasitaion map by points all of them stops
-		renderer::MapRenderer render(stops.begin(), stops.end(), settings.width,
-			settings.height, settings.padding);
-		// save settings in map renderer
-		render.SaveSettings(settings);
-
-		// init routerdata base
-		graph::TransportRouter rdb(tr_db);
-
-		// init request handler
-		handler::RequestHandler reqHandler(catalogue_db, render, rdb);
+		// publish loaded base as first version
+		snapshot::SnapshotStore store(LoadBase(path, threads));
+
+		// init request handler by current version
+		handler::RequestHandler reqHandler(store.Acquire());
 
 		// threading queries to get
-		jr.GetData(std::cout, reqHandler, queryReq);
+		profile::Scope answerScope(answerProbe);
+		const reader::BatchStats batch = jr.GetData(std::cout, reqHandler, queryReq, threads);
+		answerScope.Close();
+
+		if (printStats) {
+			PrintBatchStats(reqHandler, batch);
+		}
+
+    } else if (mode == "serve"sv) {
+
+		// base is loaded once and kept while input lasts: each line of input is
+		// document of process_requests and gets one line of answers. Changes of
+		// update_requests make new version of base in memory, it's answered after
+		// them and kept until other base is loaded
+		reader::JsonReader jr;
+		std::unique_ptr<snapshot::SnapshotStore> store;
+		std::filesystem::path basePath;
+		std::string line;
+		while (std::getline(std::cin, line)) {
+			if (line.empty()) {
+				continue;
+			}
+			try {
+				std::istringstream input(line);
+				profile::Scope parseScope(parseProbe);
+				reader::detail::UpdateData update;
+				const auto& [queryAdd, queryTowardStop, queryReq, routeSettings, nameBase] = jr.ReadRequests(input, threads, &update);
+				parseScope.Close();
+				// base is reloaded only if batch refers to other one
+				const std::filesystem::path path = nameBase;
+				if (!store || path != basePath) {
+					store.reset();
+					store = std::make_unique<snapshot::SnapshotStore>(LoadBase(path, threads));
+					basePath = path;
+				}
+				if (!update.base.stops.empty() || !update.base.distances.empty() || !update.base.buses.empty()
+					|| !update.removedStops.empty() || !update.removedBuses.empty()) {
+					profile::Scope updateScope(updateProbe);
+					store->Update({ std::move(update.base.stops), std::move(update.base.distances),
+						std::move(update.base.buses), std::move(update.removedStops), std::move(update.removedBuses) });
+				}
+				handler::RequestHandler reqHandler(store->Acquire());
+				profile::Scope answerScope(answerProbe);
+				// answers are written only when whole batch is answered,
+				// so failed batch gets nothing but error
+				std::ostringstream answers;
+				answers.precision(std::cout.precision());
+				jr.GetData(answers, reqHandler, queryReq, threads, reader::lineFraming);
+				std::cout << std::move(answers).str();
+			}
+			catch (const std::exception& error) {
+				// broken batch is answered by error, server goes on
+				PrintError(std::cout, error);
+			}
+			std::cout.flush();
+		}
+
+    } else if (mode == "stream"sv) {
+
+		// NDJSON: each line of input is one stat request, its answer or error is written
+		// in one line as soon as it is ready, so nothing but current request is kept
+		snapshot::SnapshotStore store(LoadBase(argv[2], threads));
+		handler::RequestHandler reqHandler(store.Acquire());
+		reader::JsonReader jr;
+		// own buffers of streams, otherwise input waiting in them is not seen
+		std::ios::sync_with_stdio(false);
+		std::string line;
+		while (std::getline(std::cin, line)) {
+			if (line.empty()) {
+				continue;
+			}
+			try {
+				jr.PrintAnswer(std::cout, reqHandler, jr.ReadQuery(std::move(line)));
+			}
+			catch (const std::exception& error) {
+				// broken request is answered by error, stream goes on
+				PrintError(std::cout, error);
+			}
+			// answers of requests already waiting in input are written together
+			if (std::cin.rdbuf()->in_avail() <= 0) {
+				std::cout.flush();
+			}
+		}
+
+    } else if (mode == "encode_requests"sv) {
+
+		// JSON input is converted to binary one, both modes above accept it
+		renderer::Settings settings;
+		reader::JsonReader jr;
+		const reader::ResponseData data = jr.ReadData(std::cin, settings, threads);
+		reader::binary::Write(std::cout, data, settings);
 
     } else {
         PrintUsage();
         return 1;
     }
+
+    if (profiling) {
+        profile::PrintReport(std::cerr);
+    }
+    if (!tracePath.empty()) {
+        profile::WriteTrace(tracePath);
+    }
 }
\ No newline at end of file
@@ -155,6 +155,11 @@ namespace renderer
 		settings_ = std::move(settings);
 	}
 
+	const Settings& MapRenderer::GetSettings() const
+	{
+		return settings_;
+	}
+
 	svg::Document MapRenderer::GetMap(const std::map< std::string_view, const domain::Bus*>& sortedBuses) const
 	{
 		// don't change order call of object
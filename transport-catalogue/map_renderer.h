@@ -158,6 +158,7 @@ namespace renderer
 		svg::Point operator()(geo::Coordinates coords) const;
 
 		void SaveSettings(const Settings& settings);
+		const Settings& GetSettings() const;
 
 		svg::Document GetMap(const std::map< std::string_view, const domain::Bus*>& sortedBuses) const;
 		
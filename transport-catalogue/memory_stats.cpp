@@ -0,0 +1,98 @@
+#include "memory_stats.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace memory
+{
+	namespace {
+		const std::size_t blockHeader = 8;
+		const std::size_t blockAlignment = 16;
+		const std::size_t minBlock = 32;
+		// reference counters of std::make_shared block
+		const std::size_t controlBlock = 16;
+		// length of string kept inside std::string object
+		const std::size_t shortString = 15;
+	}
+
+	std::size_t AllocatedSize(std::size_t size)
+	{
+		const std::size_t block = (size + blockHeader + blockAlignment - 1) / blockAlignment * blockAlignment;
+		return std::max(block, minBlock);
+	}
+
+	void Counter::AddBlock(std::size_t size)
+	{
+		bytes_ += size;
+		allocated_ += AllocatedSize(size);
+	}
+
+	void Counter::AddShared(std::size_t size)
+	{
+		AddBlock(size + controlBlock);
+	}
+
+	void Counter::AddString(const std::string& str)
+	{
+		if (str.capacity() > shortString) {
+			AddBlock(str.capacity() + 1);
+		}
+	}
+
+	void Counter::AddVector(const std::vector<bool>& vec)
+	{
+		if (vec.capacity() != 0) {
+			AddBlock((vec.capacity() + 7) / 8);
+		}
+	}
+
+	std::size_t Counter::GetBytes() const
+	{
+		return bytes_;
+	}
+
+	std::size_t Counter::GetAllocated() const
+	{
+		return allocated_;
+	}
+
+	void Report::Add(std::string name, std::size_t count, const Counter& counter)
+	{
+		items_.push_back({ std::move(name), count, counter.GetBytes(), counter.GetAllocated() });
+	}
+
+	const std::vector<Item>& Report::GetItems() const
+	{
+		return items_;
+	}
+
+	std::size_t Report::GetTotalBytes() const
+	{
+		std::size_t total = 0;
+		for (const Item& item : items_) {
+			total += item.bytes;
+		}
+		return total;
+	}
+
+	std::size_t Report::GetTotalAllocated() const
+	{
+		std::size_t total = 0;
+		for (const Item& item : items_) {
+			total += item.allocated;
+		}
+		return total;
+	}
+
+	void PrintReport(const Report& report, std::ostream& output)
+	{
+		output << std::left << std::setw(32) << "structure" << std::right << std::setw(12) << "items"
+			<< std::setw(16) << "bytes" << std::setw(16) << "allocated" << '\n';
+		for (const Item& item : report.GetItems()) {
+			output << std::left << std::setw(32) << item.name << std::right << std::setw(12) << item.count
+				<< std::setw(16) << item.bytes << std::setw(16) << item.allocated << '\n';
+		}
+		output << std::left << std::setw(44) << "total" << std::right
+			<< std::setw(16) << report.GetTotalBytes() << std::setw(16) << report.GetTotalAllocated() << '\n';
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace memory
+{
+	// memory taken by one structure, estimated by sizes and capacities of its containers
+	struct Item {
+		std::string name;
+		std::size_t count{ 0 };     // number of elements
+		std::size_t bytes{ 0 };     // requested from allocator
+		std::size_t allocated{ 0 }; // with headers and alignment of heap blocks
+	};
+
+	// size of heap block given by allocator for request of size bytes,
+	// estimate for glibc malloc: 8 bytes of header, 16 bytes alignment, 32 bytes minimum
+	std::size_t AllocatedSize(std::size_t size);
+
+	// sums heap blocks of one structure
+	class Counter {
+	public:
+		void AddBlock(std::size_t size);
+		// object created by std::make_shared shares one block with control block
+		void AddShared(std::size_t size);
+		// short string lives inside object and takes no heap
+		void AddString(const std::string& str);
+		template <typename T>
+		void AddVector(const std::vector<T>& vec) {
+			if (vec.capacity() != 0) {
+				AddBlock(vec.capacity() * sizeof(T));
+			}
+		}
+		void AddVector(const std::vector<bool>& vec);
+
+		std::size_t GetBytes() const;
+		std::size_t GetAllocated() const;
+
+	private:
+		std::size_t bytes_{ 0 };
+		std::size_t allocated_{ 0 };
+	};
+
+	class Report {
+	public:
+		void Add(std::string name, std::size_t count, const Counter& counter);
+
+		const std::vector<Item>& GetItems() const;
+		std::size_t GetTotalBytes() const;
+		std::size_t GetTotalAllocated() const;
+
+	private:
+		std::vector<Item> items_;
+	};
+
+	// table of items for humans
+	void PrintReport(const Report& report, std::ostream& output);
+}
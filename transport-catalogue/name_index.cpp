@@ -0,0 +1,234 @@
+#include "name_index.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace tc
+{
+	namespace {
+		// decode character starting at pos of UTF-8 text, pos is moved past it,
+		// beyond end of text for broken character
+		char32_t DecodeChar(std::string_view text, std::size_t& pos) {
+			const unsigned char lead = static_cast<unsigned char>(text[pos]);
+			std::size_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+			char32_t ch = length == 1 ? lead : lead & (0x7F >> length);
+			for (std::size_t k = 1; k < length && pos + k < text.size(); ++k) {
+				ch = (ch << 6) | (static_cast<unsigned char>(text[pos + k]) & 0x3F);
+			}
+			pos += length;
+			return ch;
+		}
+
+		// decode not more than max characters of UTF-8 text, returns number of decoded characters
+		std::size_t DecodeUtf8(std::string_view text, char32_t* out, std::size_t max) {
+			std::size_t count = 0;
+			for (std::size_t i = 0; i < text.size() && count < max; ++count) {
+				out[count] = DecodeChar(text, i);
+			}
+			return count;
+		}
+
+		// first position after pos where name doesn't start with prefix, names[pos] starts
+		// with it. Names with the same prefix are neighbours, groups are mostly small,
+		// so bound of search is doubled from pos first
+		std::size_t SkipPrefix(const std::vector<std::string_view>& names, std::size_t pos, std::string_view prefix) {
+			auto hasPrefix = [prefix](std::string_view name) {
+				return name.substr(0, prefix.size()) == prefix;
+			};
+			std::size_t step = 1;
+			while (pos + step < names.size() && hasPrefix(names[pos + step])) {
+				pos += step;
+				step *= 2;
+			}
+			const auto last = names.begin() + std::min(pos + step, names.size());
+			return std::partition_point(names.begin() + pos + 1, last, hasPrefix) - names.begin();
+		}
+
+		std::size_t CountUtf8(std::string_view text) {
+			return std::count_if(text.begin(), text.end(),
+				[](char ch) { return (static_cast<unsigned char>(ch) & 0xC0) != 0x80; });
+		}
+	}
+
+	NameIndex::NameIndex(std::vector<std::pair<std::string_view, std::size_t>> names)
+	{
+		std::sort(names.begin(), names.end());
+		names_.reserve(names.size());
+		ids_.reserve(names.size());
+		for (const auto& [name, id] : names) {
+			names_.push_back(name);
+			ids_.push_back(id);
+		}
+	}
+
+	NameIndex::NameIndex(const NameIndex& base, std::vector<std::pair<std::string_view, std::size_t>> added,
+		const std::vector<std::size_t>& droppedIds)
+	{
+		std::sort(added.begin(), added.end());
+		std::vector<bool> dropped;
+		for (const std::size_t id : droppedIds) {
+			if (dropped.size() <= id) {
+				dropped.resize(id + 1, false);
+			}
+			dropped[id] = true;
+		}
+
+		// both arrays are sorted, so they are merged in one pass
+		names_.reserve(base.names_.size() + added.size());
+		ids_.reserve(base.names_.size() + added.size());
+		auto it = added.begin();
+		for (std::size_t i = 0; i < base.names_.size(); ++i) {
+			const std::size_t id = base.ids_[i];
+			if (id < dropped.size() && dropped[id]) {
+				continue;
+			}
+			for (; it != added.end() && *it < std::pair(base.names_[i], id); ++it) {
+				names_.push_back(it->first);
+				ids_.push_back(it->second);
+			}
+			names_.push_back(base.names_[i]);
+			ids_.push_back(id);
+		}
+		for (; it != added.end(); ++it) {
+			names_.push_back(it->first);
+			ids_.push_back(it->second);
+		}
+	}
+
+	std::vector<NameMatch> NameIndex::FindByPrefix(std::string_view prefix, std::size_t limit) const
+	{
+		std::vector<NameMatch> result;
+		// names with the same prefix are neighbours in sorted array
+		auto it = std::lower_bound(names_.begin(), names_.end(), prefix);
+		for (; it != names_.end() && it->substr(0, prefix.size()) == prefix; ++it) {
+			if (limit != 0 && result.size() == limit) {
+				break;
+			}
+			result.push_back({ ids_[it - names_.begin()], 0 });
+		}
+		return result;
+	}
+
+	std::vector<NameMatch> NameIndex::FindFuzzy(std::string_view query, std::size_t maxEdits, std::size_t limit) const
+	{
+		// all buffers are allocated once per query
+		std::vector<char32_t> pattern(CountUtf8(query));
+		const std::size_t m = DecodeUtf8(query, pattern.data(), pattern.size());
+		// empty prefix of any name is m edits away from query, more edits find nothing new
+		maxEdits = std::min(maxEdits, m);
+		if (maxEdits == 0) {
+			return FindByPrefix(query, limit);
+		}
+		// names are walked in sorted order as paths of trie: row j of table holds edit
+		// distances between j first characters of name and prefixes of query, so rows
+		// of characters shared with previous name are kept. Only first m + maxEdits
+		// characters of name can match query of m characters
+		const std::size_t maxLength = m + maxEdits;
+		const std::size_t width = m + 1;
+		std::vector<std::size_t> rows((maxLength + 1) * width);
+		std::iota(rows.begin(), rows.begin() + width, std::size_t{ 0 });
+		// minimum of each row and the best distance of prefixes of name up to the row
+		std::vector<std::size_t> rowMin(maxLength + 1, 0);
+		std::vector<std::size_t> best(maxLength + 1, m);
+		// characters of current path decoded from name and their ends in bytes,
+		// rows [1, computed] belong to them
+		std::vector<char32_t> path(maxLength);
+		std::vector<std::size_t> ends(maxLength);
+		std::size_t decoded = 0;
+		std::size_t computed = 0;
+		std::string_view previous;
+
+		// found matches kept as heap with the worst match on top
+		struct Found {
+			std::size_t distance;
+			std::size_t position;
+			bool operator<(const Found& other) const {
+				return distance < other.distance || (distance == other.distance && position < other.position);
+			}
+		};
+		std::vector<Found> found;
+		found.reserve(limit != 0 ? limit + 1 : 0);
+		std::size_t threshold = maxEdits;
+
+		for (std::size_t pos = 0; pos < names_.size();) {
+			const std::string_view name = names_[pos];
+			// characters lying in bytes shared with previous name stay on path
+			const std::size_t sharedBytes = std::mismatch(name.begin(), name.end(),
+				previous.begin(), previous.end()).first - name.begin();
+			while (decoded > 0 && ends[decoded - 1] > sharedBytes) {
+				--decoded;
+			}
+			computed = std::min(computed, decoded);
+			previous = name;
+
+			std::size_t j = 0;
+			bool dropped = false;
+			while (true) {
+				if (j == decoded) {
+					std::size_t begin = decoded == 0 ? 0 : ends[decoded - 1];
+					if (begin >= name.size() || decoded == maxLength) {
+						break;
+					}
+					path[decoded] = DecodeChar(name, begin);
+					ends[decoded++] = begin;
+				}
+				++j;
+				if (j > computed) {
+					const std::size_t* prevRow = &rows[(j - 1) * width];
+					std::size_t* row = &rows[j * width];
+					const char32_t ch = path[j - 1];
+					row[0] = j;
+					std::size_t low = j;
+					for (std::size_t i = 1; i <= m; ++i) {
+						const std::size_t replace = prevRow[i - 1] + (pattern[i - 1] == ch ? 0 : 1);
+						row[i] = std::min({ replace, prevRow[i] + 1, row[i - 1] + 1 });
+						low = std::min(low, row[i]);
+					}
+					rowMin[j] = low;
+					best[j] = std::min(best[j - 1], row[m]);
+					computed = j;
+				}
+				// minimum of rows doesn't decrease with length of prefix
+				if (rowMin[j] > threshold) {
+					dropped = true;
+					break;
+				}
+				if (rowMin[j] >= best[j]) {
+					break;
+				}
+			}
+			if (dropped) {
+				// no name with the same j first characters can match
+				pos = SkipPrefix(names_, pos, name.substr(0, ends[j - 1]));
+				continue;
+			}
+			// query may match any prefix of name
+			const std::size_t distance = best[j];
+			if (distance <= threshold) {
+				found.push_back({ distance, pos });
+				std::push_heap(found.begin(), found.end());
+				if (limit != 0 && found.size() > limit) {
+					std::pop_heap(found.begin(), found.end());
+					found.pop_back();
+					// worse names can't get to result any more
+					threshold = found.front().distance;
+				}
+			}
+			++pos;
+		}
+
+		std::sort_heap(found.begin(), found.end());
+		std::vector<NameMatch> result;
+		result.reserve(found.size());
+		for (const Found& item : found) {
+			result.push_back({ ids_[item.position], item.distance });
+		}
+		return result;
+	}
+
+	void NameIndex::CountMemory(memory::Counter& counter) const
+	{
+		counter.AddVector(names_);
+		counter.AddVector(ids_);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "memory_stats.h"
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+	// name found by search
+	struct NameMatch {
+		std::size_t id{ 0 };
+		std::size_t distance{ 0 }; // number of edits between query and prefix of name
+	};
+
+	// sorted array of names for prefix and fuzzy search,
+	// names are views on strings owned by catalogue
+	class NameIndex {
+	public:
+		NameIndex() = default;
+		// pairs of name and id of its owner
+		explicit NameIndex(std::vector<std::pair<std::string_view, std::size_t>> names);
+		// names of base without names of dropped ids, merged with added names
+		NameIndex(const NameIndex& base, std::vector<std::pair<std::string_view, std::size_t>> added,
+			const std::vector<std::size_t>& droppedIds);
+
+		// names starting with prefix in alphabetical order, limit equal to zero means all names
+		std::vector<NameMatch> FindByPrefix(std::string_view prefix, std::size_t limit) const;
+		// names whose prefix differs from query by not more than maxEdits insertions,
+		// deletions or replacements of characters, sorted by distance and name.
+		// maxEdits above length of query gives the same result as length of query
+		std::vector<NameMatch> FindFuzzy(std::string_view query, std::size_t maxEdits, std::size_t limit) const;
+		// names are views, only arrays are counted
+		void CountMemory(memory::Counter& counter) const;
+
+	private:
+		std::vector<std::string_view> names_;
+		// id of owner for each name in names_
+		std::vector<std::size_t> ids_;
+	};
+}
@@ -0,0 +1,182 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace tc
+{
+	namespace {
+		const std::uint64_t golden = 0x9E3779B97F4A7C15ull;
+		// average size of bucket, larger buckets make hash smaller but slower to build
+		const std::size_t namesPerBucket = 3;
+		// seeds tried before giving up
+		const std::uint64_t maxAttempts = 32;
+
+		// FNV-1a, hash is saved in base so it must not depend on platform
+		std::uint64_t HashName(std::string_view name) {
+			std::uint64_t h = 14695981039346656037ull;
+			for (const char ch : name) {
+				h ^= static_cast<unsigned char>(ch);
+				h *= 1099511628211ull;
+			}
+			return h;
+		}
+
+		// finalizer of splitmix64, spreads bits of hash mixed with salt
+		std::uint64_t Mix(std::uint64_t h, std::uint64_t salt) {
+			std::uint64_t x = h + salt;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			return x ^ (x >> 31);
+		}
+
+		// map hash to range [0, size) by multiplication instead of division
+		std::size_t Reduce(std::uint64_t h, std::size_t size) {
+			return static_cast<std::size_t>(((h >> 32) * size) >> 32);
+		}
+
+		std::size_t GetBucket(std::uint64_t h, std::uint64_t seed, std::size_t numBuckets) {
+			return Reduce(Mix(h, seed), numBuckets);
+		}
+
+		std::size_t GetSlot(std::uint64_t h, std::uint64_t seed, std::uint32_t displacement, std::size_t size) {
+			return Reduce(Mix(h, seed + (displacement + 1ull) * golden), size);
+		}
+	}
+
+	PerfectHash::PerfectHash(std::vector<std::pair<std::string_view, std::size_t>> names)
+	{
+		// equal names become neighbours, the last of them is kept
+		std::stable_sort(names.begin(), names.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.first < rhs.first;
+		});
+		std::vector<std::uint64_t> hashes;
+		std::vector<std::size_t> ids;
+		hashes.reserve(names.size());
+		ids.reserve(names.size());
+		for (std::size_t i = 0; i < names.size(); ++i) {
+			if (i + 1 < names.size() && names[i + 1].first == names[i].first) {
+				continue;
+			}
+			hashes.push_back(HashName(names[i].first));
+			ids.push_back(names[i].second);
+		}
+
+		for (std::uint64_t attempt = 0; attempt < maxAttempts; ++attempt) {
+			seed_ = Mix(attempt, golden);
+			if (TryBuild(hashes, ids)) {
+				return;
+			}
+		}
+		throw std::runtime_error("can't build perfect hash of names");
+	}
+
+	PerfectHash::PerfectHash(std::uint64_t seed, std::vector<std::uint32_t> displacements,
+		std::vector<std::uint32_t> ids)
+		: seed_(seed), displacements_(std::move(displacements)), ids_(std::move(ids))
+	{
+	}
+
+	bool PerfectHash::TryBuild(const std::vector<std::uint64_t>& hashes, const std::vector<std::size_t>& ids)
+	{
+		const std::size_t size = hashes.size();
+		const std::size_t numBuckets = size / namesPerBucket + 1;
+
+		// group names by buckets
+		std::vector<std::size_t> bucketOffsets(numBuckets + 1, 0);
+		std::vector<std::size_t> bucketOf(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			bucketOf[i] = GetBucket(hashes[i], seed_, numBuckets);
+			++bucketOffsets[bucketOf[i] + 1];
+		}
+		std::partial_sum(bucketOffsets.begin(), bucketOffsets.end(), bucketOffsets.begin());
+		std::vector<std::size_t> members(size);
+		std::vector<std::size_t> position(bucketOffsets.begin(), bucketOffsets.end() - 1);
+		for (std::size_t i = 0; i < size; ++i) {
+			members[position[bucketOf[i]]++] = i;
+		}
+
+		// large buckets are placed first while there are many free slots
+		std::vector<std::size_t> order(numBuckets);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&bucketOffsets](std::size_t lhs, std::size_t rhs) {
+			return bucketOffsets[lhs + 1] - bucketOffsets[lhs] > bucketOffsets[rhs + 1] - bucketOffsets[rhs];
+		});
+
+		displacements_.assign(numBuckets, 0);
+		ids_.assign(size, 0);
+		std::vector<bool> taken(size, false);
+		std::vector<std::size_t> slots;
+		// the last buckets take the last free slots, it needs about size tries
+		const std::uint64_t maxDisplacement = std::min<std::uint64_t>(
+			std::uint64_t{ size } * 16 + 1024, UINT32_MAX);
+		for (const std::size_t bucket : order) {
+			const std::size_t begin = bucketOffsets[bucket];
+			const std::size_t end = bucketOffsets[bucket + 1];
+			if (begin == end) {
+				break;
+			}
+			bool placed = false;
+			for (std::uint32_t displacement = 0; displacement < maxDisplacement && !placed; ++displacement) {
+				slots.clear();
+				placed = true;
+				for (std::size_t k = begin; k < end; ++k) {
+					const std::size_t slot = GetSlot(hashes[members[k]], seed_, displacement, size);
+					if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+						placed = false;
+						break;
+					}
+					slots.push_back(slot);
+				}
+				if (placed) {
+					displacements_[bucket] = displacement;
+				}
+			}
+			if (!placed) {
+				return false;
+			}
+			for (std::size_t k = begin; k < end; ++k) {
+				taken[slots[k - begin]] = true;
+				ids_[slots[k - begin]] = static_cast<std::uint32_t>(ids[members[k]]);
+			}
+		}
+		return true;
+	}
+
+	std::optional<std::size_t> PerfectHash::Find(std::string_view name) const
+	{
+		if (ids_.empty() || displacements_.empty()) {
+			return std::nullopt;
+		}
+		const std::uint64_t h = HashName(name);
+		const std::size_t bucket = GetBucket(h, seed_, displacements_.size());
+		return ids_[GetSlot(h, seed_, displacements_[bucket], ids_.size())];
+	}
+
+	std::size_t PerfectHash::Size() const
+	{
+		return ids_.size();
+	}
+
+	std::uint64_t PerfectHash::GetSeed() const
+	{
+		return seed_;
+	}
+
+	const std::vector<std::uint32_t>& PerfectHash::GetDisplacements() const
+	{
+		return displacements_;
+	}
+
+	const std::vector<std::uint32_t>& PerfectHash::GetIds() const
+	{
+		return ids_;
+	}
+
+	void PerfectHash::CountMemory(memory::Counter& counter) const
+	{
+		counter.AddVector(displacements_);
+		counter.AddVector(ids_);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "memory_stats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+	// minimal perfect hash over fixed set of names, every name of set has own slot
+	// keeping id of its owner. Name out of set gets slot of some other name,
+	// so owner found by hash must be compared with wanted name
+	class PerfectHash {
+	public:
+		PerfectHash() = default;
+		// pairs of name and id of its owner, for repeated name the last pair is kept
+		explicit PerfectHash(std::vector<std::pair<std::string_view, std::size_t>> names);
+		// restore saved hash
+		PerfectHash(std::uint64_t seed, std::vector<std::uint32_t> displacements,
+			std::vector<std::uint32_t> ids);
+
+		// id of owner of name, nullopt only for empty set
+		std::optional<std::size_t> Find(std::string_view name) const;
+
+		std::size_t Size() const;
+		std::uint64_t GetSeed() const;
+		const std::vector<std::uint32_t>& GetDisplacements() const;
+		const std::vector<std::uint32_t>& GetIds() const;
+		void CountMemory(memory::Counter& counter) const;
+
+	private:
+		std::uint64_t seed_{ 0 };
+		// bucket -> displacement moving names of bucket to free slots
+		std::vector<std::uint32_t> displacements_;
+		// slot -> id of owner
+		std::vector<std::uint32_t> ids_;
+
+		// place hashes of names with current seed, false if some bucket can't be placed
+		bool TryBuild(const std::vector<std::uint64_t>& hashes, const std::vector<std::size_t>& ids);
+	};
+}
@@ -0,0 +1,256 @@
+#include "profile.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profile
+{
+	using namespace std::literals;
+
+	namespace {
+		std::size_t HighestBit(std::uint64_t value) {
+#ifdef __GNUC__
+			return 63 - static_cast<std::size_t>(__builtin_clzll(value));
+#else
+			std::size_t bit = 0;
+			while (value >>= 1) {
+				++bit;
+			}
+			return bit;
+#endif
+		}
+
+		// one timed scope of trace
+		struct Event {
+			std::string_view name;
+			std::uint64_t start = 0;
+			std::uint64_t duration = 0;
+			std::uint32_t thread = 0;
+		};
+
+		struct Registry {
+			std::mutex mutex;
+			std::vector<std::unique_ptr<Histogram>> histograms;
+			// events of finished threads
+			std::vector<Event> events;
+			std::uint32_t threads = 0;
+			Clock::time_point start = Clock::now();
+		};
+
+		Registry& GetRegistry() {
+			static Registry registry;
+			return registry;
+		}
+
+		// events are collected by thread and given to registry when thread ends
+		class ThreadEvents {
+		public:
+			ThreadEvents() {
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> guard(registry.mutex);
+				thread_ = ++registry.threads;
+			}
+			~ThreadEvents() {
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> guard(registry.mutex);
+				registry.events.insert(registry.events.end(), events_.begin(), events_.end());
+			}
+
+			void Add(std::string_view name, std::uint64_t start, std::uint64_t duration) {
+				events_.push_back({ name, start, duration, thread_ });
+			}
+
+			std::vector<Event> Take() {
+				return std::move(events_);
+			}
+
+		private:
+			std::vector<Event> events_;
+			std::uint32_t thread_ = 0;
+		};
+
+		ThreadEvents& GetThreadEvents() {
+			thread_local ThreadEvents events;
+			return events;
+		}
+
+		std::uint64_t ToNanoseconds(Clock::duration duration) {
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+		}
+	}
+
+	void Enable(bool trace)
+	{
+		// registry starts clock of trace
+		GetRegistry();
+		detail::enabled = true;
+		detail::tracing = trace;
+	}
+
+	/*****************************Histogram****************************/
+	Histogram::Histogram(std::string name)
+		: name_(std::move(name))
+	{
+	}
+
+	std::size_t Histogram::GetBucket(std::uint64_t value)
+	{
+		if (value < subBuckets) {
+			return static_cast<std::size_t>(value);
+		}
+		// value >> shift keeps 7 bits, in [64, 128)
+		const std::size_t shift = HighestBit(value) - 6;
+		return subBuckets + (shift - 1) * subBuckets / 2 + static_cast<std::size_t>((value >> shift) - subBuckets / 2);
+	}
+
+	std::uint64_t Histogram::GetBucketMax(std::size_t bucket)
+	{
+		if (bucket < subBuckets) {
+			return bucket;
+		}
+		const std::size_t shift = (bucket - subBuckets) / (subBuckets / 2) + 1;
+		const std::uint64_t mantissa = (bucket - subBuckets) % (subBuckets / 2) + subBuckets / 2;
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+	void Histogram::Record(std::uint64_t nanoseconds)
+	{
+		counts_[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		count_.fetch_add(1, std::memory_order_relaxed);
+		sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+		std::uint64_t max = max_.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+		}
+	}
+
+	const std::string& Histogram::GetName() const
+	{
+		return name_;
+	}
+
+	std::uint64_t Histogram::GetCount() const
+	{
+		return count_.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t Histogram::GetMax() const
+	{
+		return max_.load(std::memory_order_relaxed);
+	}
+
+	double Histogram::GetMean() const
+	{
+		const std::uint64_t count = GetCount();
+		return count == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / count;
+	}
+
+	std::uint64_t Histogram::GetPercentile(double quantile) const
+	{
+		const std::uint64_t count = GetCount();
+		if (count == 0) {
+			return 0;
+		}
+		// rank of value, the first one is 1
+		const std::uint64_t rank = std::max<std::uint64_t>(1,
+			static_cast<std::uint64_t>(quantile * static_cast<double>(count) + 0.5));
+		std::uint64_t seen = 0;
+		for (std::size_t bucket = 0; bucket < bucketCount; ++bucket) {
+			seen += counts_[bucket].load(std::memory_order_relaxed);
+			if (seen >= rank) {
+				return std::min(GetBucketMax(bucket), GetMax());
+			}
+		}
+		return GetMax();
+	}
+
+	/*****************************Probe********************************/
+	Histogram& Probe::GetHistogram()
+	{
+		Histogram* histogram = histogram_.load(std::memory_order_acquire);
+		if (histogram != nullptr) {
+			return *histogram;
+		}
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.mutex);
+		for (const auto& item : registry.histograms) {
+			if (item->GetName() == name_) {
+				histogram = item.get();
+				break;
+			}
+		}
+		if (histogram == nullptr) {
+			histogram = registry.histograms.emplace_back(std::make_unique<Histogram>(std::string(name_))).get();
+		}
+		histogram_.store(histogram, std::memory_order_release);
+		return *histogram;
+	}
+
+	void Scope::Finish()
+	{
+		const Clock::time_point end = Clock::now();
+		const std::uint64_t duration = ToNanoseconds(end - start_);
+		probe_->GetHistogram().Record(duration);
+		if (detail::tracing) {
+			GetThreadEvents().Add(probe_->GetHistogram().GetName(),
+				ToNanoseconds(start_ - GetRegistry().start), duration);
+		}
+		probe_ = nullptr;
+	}
+
+	/*****************************Output*******************************/
+	void PrintReport(std::ostream& output)
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> guard(registry.mutex);
+		const auto flags = output.flags();
+		const auto precision = output.precision();
+		output << std::left << std::setw(24) << "probe" << std::right << std::setw(12) << "count"
+			<< std::setw(12) << "mean us" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+			<< std::setw(12) << "p999 us" << std::setw(12) << "max us" << '\n';
+		output << std::fixed << std::setprecision(1);
+		for (const auto& histogram : registry.histograms) {
+			output << std::left << std::setw(24) << histogram->GetName() << std::right
+				<< std::setw(12) << histogram->GetCount()
+				<< std::setw(12) << histogram->GetMean() / 1000.0
+				<< std::setw(12) << histogram->GetPercentile(0.5) / 1000.0
+				<< std::setw(12) << histogram->GetPercentile(0.99) / 1000.0
+				<< std::setw(12) << histogram->GetPercentile(0.999) / 1000.0
+				<< std::setw(12) << histogram->GetMax() / 1000.0 << '\n';
+		}
+		output.flags(flags);
+		output.precision(precision);
+	}
+
+	void WriteTrace(const std::filesystem::path& path)
+	{
+		std::vector<Event> events = GetThreadEvents().Take();
+		Registry& registry = GetRegistry();
+		{
+			std::lock_guard<std::mutex> guard(registry.mutex);
+			events.insert(events.end(), registry.events.begin(), registry.events.end());
+			registry.events.clear();
+		}
+
+		std::ofstream output(path, std::ios::trunc);
+		// time is written in microseconds with fraction of nanoseconds
+		output.precision(15);
+		json::Writer writer(output);
+		writer.StartDict().Key("traceEvents"sv).StartArray();
+		for (const Event& event : events) {
+			writer.StartDict()
+				.Key("name"sv).Value(event.name)
+				.Key("ph"sv).Value("X"sv)
+				.Key("ts"sv).Value(event.start / 1000.0)
+				.Key("dur"sv).Value(event.duration / 1000.0)
+				.Key("pid"sv).Value(1)
+				.Key("tid"sv).Value(static_cast<std::size_t>(event.thread))
+				.EndDict();
+		}
+		writer.EndArray().Key("displayTimeUnit"sv).Value("ms"sv).EndDict();
+	}
+}
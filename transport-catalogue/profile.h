@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace profile
+{
+	namespace detail {
+		// set once by Enable before threads are started
+		inline bool enabled = false;
+		inline bool tracing = false;
+	}
+
+	// instrumentation is off by default, probes cost one check of flag then
+	void Enable(bool trace);
+
+	inline bool IsEnabled() {
+		return detail::enabled;
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	// log-linear buckets of nanoseconds as in HDR histogram: values below 128 have
+	// own buckets, larger ones are kept with 7 significant bits, that is 64 buckets
+	// per power of two, so error is below 1/64, about 1.6%.
+	// Threads record values at once without locks
+	class Histogram {
+	public:
+		explicit Histogram(std::string name);
+		Histogram(const Histogram&) = delete;
+		Histogram& operator=(const Histogram&) = delete;
+
+		void Record(std::uint64_t nanoseconds);
+
+		const std::string& GetName() const;
+		std::uint64_t GetCount() const;
+		std::uint64_t GetMax() const;
+		double GetMean() const;
+		// the largest value of bucket with quantile, quantile is in [0, 1]
+		std::uint64_t GetPercentile(double quantile) const;
+
+	private:
+		static const std::size_t subBuckets = 128;
+		static const std::size_t bucketCount = subBuckets + (64 - 7) * subBuckets / 2;
+
+		std::string name_;
+		std::array<std::atomic<std::uint64_t>, bucketCount> counts_{};
+		std::atomic<std::uint64_t> count_{ 0 };
+		std::atomic<std::uint64_t> sum_{ 0 };
+		std::atomic<std::uint64_t> max_{ 0 };
+
+		static std::size_t GetBucket(std::uint64_t value);
+		static std::uint64_t GetBucketMax(std::size_t bucket);
+	};
+
+	// named place of code, histogram is found by name when it's used first time,
+	// probes of the same name share it. Probes are made at static initialization
+	class Probe {
+	public:
+		constexpr explicit Probe(std::string_view name) : name_(name) {}
+		Probe(const Probe&) = delete;
+		Probe& operator=(const Probe&) = delete;
+
+		Histogram& GetHistogram();
+
+	private:
+		std::string_view name_;
+		std::atomic<Histogram*> histogram_{ nullptr };
+	};
+
+	// measures time from construction to Close or destruction
+	class Scope {
+	public:
+		explicit Scope(Probe& probe) {
+			if (IsEnabled()) {
+				probe_ = &probe;
+				start_ = Clock::now();
+			}
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		~Scope() {
+			Close();
+		}
+
+		void Close() {
+			if (probe_ != nullptr) {
+				Finish();
+			}
+		}
+
+	private:
+		Probe* probe_ = nullptr;
+		Clock::time_point start_;
+
+		void Finish();
+	};
+
+	// histograms in order of their first use
+	void PrintReport(std::ostream& output);
+	// events of all threads in Chrome trace_event format, it's read by chrome://tracing
+	// and Perfetto. Threads which recorded events must be finished or be current one
+	void WriteTrace(const std::filesystem::path& path);
+}
@@ -1,8 +1,10 @@
 #include "request_handler.h"
 #include "map_renderer.h"
+#include "json_writer.h"
 
 #include <algorithm>
 #include <map>
+#include <sstream>
 
 
 namespace handler
@@ -10,14 +12,32 @@ namespace handler
 	/************Constructor*************/
 	RequestHandler::RequestHandler(const tc::TransportCatalogue & db,
 		const renderer::MapRenderer & renderer,
-		const graph::TransportRouter& tr)	:db_(db), renderer_(renderer), rdb_(tr) {}
+		const graph::TransportRouter& tr)	:db_(db), renderer_(renderer), rdb_(tr),
+		map_(std::make_shared<snapshot::MapCache>()) {}
+
+	RequestHandler::RequestHandler(std::shared_ptr<const snapshot::Snapshot> snapshot)
+		: db_(*snapshot->catalogue), renderer_(*snapshot->renderer), rdb_(*snapshot->router),
+		snapshot_(std::move(snapshot)), map_(snapshot_, &snapshot_->map) {}
 	
 	/*************************************/
 
+	const domain::Bus* RequestHandler::FindBus(std::string_view bus_name) const
+	{
+		return db_.SearchRoute(bus_name);
+	}
+
+	const domain::Stop* RequestHandler::FindStop(std::string_view stop_name) const
+	{
+		return db_.SearchStop(stop_name);
+	}
+
 	std::optional<BusStat> RequestHandler::GetBusStat(const std::string_view & bus_name) const
 	{
-		const domain::Bus* bus = db_.SearchRoute(bus_name);
+		return GetBusStat(db_.SearchRoute(bus_name));
+	}
 
+	std::optional<BusStat> RequestHandler::GetBusStat(const domain::Bus* bus) const
+	{
 		if (bus == nullptr) {
 			return std::nullopt;
 		}
@@ -26,18 +46,75 @@ namespace handler
 			bus->lengthRoute, bus->curvature });
 	}
 
-	const std::unordered_set<BusPtr>* RequestHandler::GetBusesByStop(const std::string_view & stop_name) const
+	std::optional<tc::StopBuses> RequestHandler::GetBusesByStop(const std::string_view & stop_name) const
 	{
 		return db_.GetStopToBuses(stop_name);
 	}
+
+	std::optional<tc::StopBuses> RequestHandler::GetBusesByStop(const domain::Stop* stop) const
+	{
+		return db_.GetStopToBuses(stop);
+	}
 	
+	std::vector<std::pair<const domain::Stop*, double>> RequestHandler::GetNearestStops(geo::Coordinates center,
+		double radius, std::size_t limit) const
+	{
+		return db_.GetNearestStops(center, radius, limit);
+	}
+
+	std::vector<const domain::Stop*> RequestHandler::SearchStops(std::string_view query,
+		std::size_t maxEdits, std::size_t limit) const
+	{
+		return db_.SearchStopsByName(query, maxEdits, limit);
+	}
+
+	std::optional<graph::VertexId> RequestHandler::GetStopVertex(const std::string_view& stop_name) const
+	{
+		return GetStopVertex(db_.SearchStop(stop_name));
+	}
+
+	std::optional<graph::VertexId> RequestHandler::GetStopVertex(const domain::Stop* stop) const
+	{
+		return rdb_.GetMakedGraph().GetStopVertex(stop);
+	}
+
 	svg::Document RequestHandler::RenderMap() const
 	{
 		return renderer_.GetMap(db_.GetSortedBuses());
 	}
 
+	const std::string& RequestHandler::GetMapJson() const
+	{
+		return map_->Get([this]() {
+			return RenderMapJson(db_, renderer_);
+		});
+	}
+
+	memory::Report RequestHandler::GetMemoryStats() const
+	{
+		memory::Report report;
+		db_.CollectMemory(report);
+		rdb_.GetMakedGraph().CollectMemory(report);
+		rdb_.CollectMemory(report);
+		return report;
+	}
+
 	const graph::TransportRouter& RequestHandler::GetRouter() const
 	{
 		return rdb_;
 	}
+
+	std::string RenderMapJson(const tc::TransportCatalogue& db, const renderer::MapRenderer& renderer)
+	{
+		const svg::Document doc = renderer.GetMap(db.GetSortedBuses());
+		std::ostringstream out;
+		{
+			// svg is escaped while it is rendered
+			json::Writer writer(out);
+			writer.StringValue([&doc](std::ostream& stream) {
+				doc.Render(stream);
+			});
+		}
+		return std::move(out).str();
+	}
 }
\ No newline at end of file
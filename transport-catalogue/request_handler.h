@@ -2,6 +2,8 @@
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
+#include "snapshot.h"
+#include "memory_stats.h"
 
 #include <optional>
 #include <memory>
@@ -26,16 +28,42 @@ namespace handler {
 	public:
 		RequestHandler(const tc::TransportCatalogue& db, const renderer::MapRenderer& renderer,
 			const graph::TransportRouter& tr);
+		//    ,     
+		explicit RequestHandler(std::shared_ptr<const snapshot::Snapshot> snapshot);
 				
+		//      ,  nullptr,   
+		const domain::Bus* FindBus(std::string_view bus_name) const;
+		const domain::Stop* FindStop(std::string_view stop_name) const;
+
 		//     ( Bus)
 		std::optional<BusStat> GetBusStat(const std::string_view& bus_name) const;
+		std::optional<BusStat> GetBusStat(const domain::Bus* bus) const;
 
 		//  ,  
-		const std::unordered_set<BusPtr>* GetBusesByStop(const std::string_view& stop_name) const;
+		std::optional<tc::StopBuses> GetBusesByStop(const std::string_view& stop_name) const;
+		std::optional<tc::StopBuses> GetBusesByStop(const domain::Stop* stop) const;
+
+		//      ,   
+		std::vector<std::pair<const domain::Stop*, double>> GetNearestStops(geo::Coordinates center,
+			double radius, std::size_t limit) const;
+
+		//  ,     
+		std::vector<const domain::Stop*> SearchStops(std::string_view query,
+			std::size_t maxEdits, std::size_t limit) const;
+
+		//       
+		std::optional<graph::VertexId> GetStopVertex(const std::string_view& stop_name) const;
+		std::optional<graph::VertexId> GetStopVertex(const domain::Stop* stop) const;
 
 		//  
 		svg::Document RenderMap() const;
 
+		//     JSON   SVG,      
+		const std::string& GetMapJson() const;
+
+		//   ,   ,   
+		memory::Report GetMemoryStats() const;
+
 		const graph::TransportRouter& GetRouter() const;
 		
 	private:
@@ -43,5 +71,11 @@ namespace handler {
 		const tc::TransportCatalogue& db_;
 		const renderer::MapRenderer& renderer_;
 		const graph::TransportRouter& rdb_;
+		std::shared_ptr<const snapshot::Snapshot> snapshot_;
+		//    ,   
+		std::shared_ptr<const snapshot::MapCache> map_;
 	};
+
+	//         JSON
+	std::string RenderMapJson(const tc::TransportCatalogue& db, const renderer::MapRenderer& renderer);
 }
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "graph.h"
+#include "memory_stats.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -22,6 +24,11 @@ namespace graph {
 
 	public:
 		explicit Router(const Graph& graph);
+		// routes of graph made of graph of base by appending vertices and edges, so ids of base
+		// are the same in graph. Rows of routes of base are shared and copied only when some
+		// route of row gets shorter, routes are relaxed only through ends of added edges:
+		// any new route passes through them
+		Router(const Graph& graph, const Router& base);
 
 		struct RouteInfo {
 			Weight weight;
@@ -29,24 +36,50 @@ namespace graph {
 		};
 
 		std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+		// table of routes between all pairs of vertices, rows shared with other routers are counted too
+		void CountMemory(memory::Counter& counter) const;
 		
 	private:
 		struct RouteInternalData {
 			Weight weight;
 			std::optional<EdgeId> prev_edge;
 		};
-		using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+		// routes from one vertex, row shared with base may be shorter than number of vertices
+		using Row = std::vector<std::optional<RouteInternalData>>;
+		// rows are never changed after router is built, so routers share them
+		using RoutesInternalData = std::vector<std::shared_ptr<Row>>;
+
+		static const std::optional<RouteInternalData>& GetRoute(const Row& row, VertexId vertex_to) {
+			static const std::optional<RouteInternalData> no_route;
+			return vertex_to < row.size() ? row[vertex_to] : no_route;
+		}
+
+		// data of rows owned by router being built, nullptr for row shared with other router
+		using OwnRows = std::vector<std::optional<RouteInternalData>*>;
+
+		// row of vertex_from ready for changes, row shared with other router is copied first
+		std::optional<RouteInternalData>* GetOwnRow(VertexId vertex_from, size_t vertex_count, OwnRows& own_rows) {
+			if (!own_rows[vertex_from]) {
+				const Row& shared_row = *routes_internal_data_[vertex_from];
+				auto row = std::make_shared<Row>(vertex_count);
+				std::copy(shared_row.begin(), shared_row.end(), row->begin());
+				own_rows[vertex_from] = row->data();
+				routes_internal_data_[vertex_from] = std::move(row);
+			}
+			return own_rows[vertex_from];
+		}
 
 		void InitializeRoutesInternalData(const Graph& graph) {
 			const size_t vertex_count = graph.GetVertexCount();
 			for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-				routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+				Row& row = *routes_internal_data_[vertex];
+				row[vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
 				for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
 					const auto& edge = graph.GetEdge(edge_id);
 					if (edge.weight < ZERO_WEIGHT) {
 						throw std::domain_error("Edges' weights should be non-negative");
 					}
-					auto& route_internal_data = routes_internal_data_[vertex][edge.to];
+					auto& route_internal_data = row[edge.to];
 					if (!route_internal_data || route_internal_data->weight > edge.weight) {
 						route_internal_data = RouteInternalData{ edge.weight, edge_id };
 					}
@@ -54,9 +87,8 @@ namespace graph {
 			}
 		}
 
-		void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
+		void RelaxRoute(std::optional<RouteInternalData>& route_relaxing, const RouteInternalData& route_from,
 			const RouteInternalData& route_to) {
-			auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
 			const Weight candidate_weight = route_from.weight + route_to.weight;
 			if (!route_relaxing || candidate_weight < route_relaxing->weight) {
 				route_relaxing = { candidate_weight,
@@ -64,14 +96,40 @@ namespace graph {
 			}
 		}
 
-		void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
+		// row of vertex_through is not changed: routes from it through itself are not shorter
+		void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through, OwnRows& own_rows) {
+			// sizes of rows are read once, writes to routes can't change them
+			const Row& row_through = *routes_internal_data_[vertex_through];
+			const std::optional<RouteInternalData>* const routes_to = row_through.data();
+			const size_t through_size = row_through.size();
 			for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-				if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-					for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-						if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-							RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+				const std::optional<RouteInternalData>* const own_row = own_rows[vertex_from];
+				const auto& route_through = own_row ? own_row[vertex_through]
+					: GetRoute(*routes_internal_data_[vertex_from], vertex_through);
+				if (vertex_from == vertex_through || !route_through) {
+					continue;
+				}
+				const RouteInternalData route_from = *route_through;
+				VertexId vertex_to = 0;
+				if (!own_row) {
+					// shared row is copied only from its first route getting shorter
+					const Row& shared_row = *routes_internal_data_[vertex_from];
+					for (; vertex_to < through_size; ++vertex_to) {
+						const auto& route_to = routes_to[vertex_to];
+						const auto& route_relaxing = GetRoute(shared_row, vertex_to);
+						if (route_to && (!route_relaxing || route_from.weight + route_to->weight < route_relaxing->weight)) {
+							break;
 						}
 					}
+					if (vertex_to == through_size) {
+						continue;
+					}
+				}
+				std::optional<RouteInternalData>* const row = GetOwnRow(vertex_from, vertex_count, own_rows);
+				for (; vertex_to < through_size; ++vertex_to) {
+					if (const auto& route_to = routes_to[vertex_to]) {
+						RelaxRoute(row[vertex_to], route_from, *route_to);
+					}
 				}
 			}
 		}
@@ -84,21 +142,61 @@ namespace graph {
 	template <typename Weight>
 	Router<Weight>::Router(const Graph& graph)
 		: graph_(graph)
-		, routes_internal_data_(graph.GetVertexCount(),
-			std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+		, routes_internal_data_(graph.GetVertexCount())
 	{
+		const size_t vertex_count = graph.GetVertexCount();
+		OwnRows own_rows(vertex_count);
+		for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+			routes_internal_data_[vertex] = std::make_shared<Row>(vertex_count);
+			own_rows[vertex] = routes_internal_data_[vertex]->data();
+		}
 		InitializeRoutesInternalData(graph);
 
+		for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+			RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through, own_rows);
+		}
+	}
+
+	template <typename Weight>
+	Router<Weight>::Router(const Graph& graph, const Router& base)
+		: graph_(graph)
+		, routes_internal_data_(base.routes_internal_data_)
+	{
 		const size_t vertex_count = graph.GetVertexCount();
+		OwnRows own_rows(vertex_count);
+		routes_internal_data_.resize(vertex_count);
+		for (VertexId vertex = base.routes_internal_data_.size(); vertex < vertex_count; ++vertex) {
+			routes_internal_data_[vertex] = std::make_shared<Row>(vertex_count);
+			own_rows[vertex] = routes_internal_data_[vertex]->data();
+			own_rows[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
+		}
+
+		std::vector<bool> is_end(vertex_count, false);
+		for (EdgeId edge_id = base.graph_.GetEdgeCount(); edge_id < graph.GetEdgeCount(); ++edge_id) {
+			const auto& edge = graph.GetEdge(edge_id);
+			if (edge.weight < ZERO_WEIGHT) {
+				throw std::domain_error("Edges' weights should be non-negative");
+			}
+			const auto& route_internal_data = GetRoute(*routes_internal_data_[edge.from], edge.to);
+			if (!route_internal_data || route_internal_data->weight > edge.weight) {
+				GetOwnRow(edge.from, vertex_count, own_rows)[edge.to] = RouteInternalData{ edge.weight, edge_id };
+			}
+			is_end[edge.from] = true;
+			is_end[edge.to] = true;
+		}
+
 		for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-			RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+			if (is_end[vertex_through]) {
+				RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through, own_rows);
+			}
 		}
 	}
 
 	template <typename Weight>
 	std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
 		VertexId to) const {
-		const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+		const Row& row = *routes_internal_data_.at(from);
+		const auto& route_internal_data = GetRoute(row, to);
 		if (!route_internal_data) {
 			return std::nullopt;
 		}
@@ -106,7 +204,7 @@ namespace graph {
 		std::vector<EdgeId> edges;
 		for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
 			edge_id;
-			edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+			edge_id = GetRoute(row, graph_.GetEdge(*edge_id).from)->prev_edge)
 		{
 			edges.push_back(*edge_id);
 		}
@@ -114,5 +212,15 @@ namespace graph {
 
 		return RouteInfo{ weight, std::move(edges) };
 	}
+
+	template <typename Weight>
+	void Router<Weight>::CountMemory(memory::Counter& counter) const
+	{
+		counter.AddVector(routes_internal_data_);
+		for (const auto& row : routes_internal_data_) {
+			counter.AddShared(sizeof(Row));
+			counter.AddVector(*row);
+		}
+	}
 		
 }  // namespace graph
\ No newline at end of file
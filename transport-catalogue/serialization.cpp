@@ -3,12 +3,31 @@
 #include"svg.h"
 #include <string>
 
+namespace {
+    void SetPerfectHash(const tc::PerfectHash& hash, transport_catalogue_serialize::PerfectHash& hash_db)
+    {
+        hash_db.set_seed(hash.GetSeed());
+        for (const uint32_t displacement : hash.GetDisplacements()) {
+            hash_db.add_displacements(displacement);
+        }
+        for (const uint32_t id : hash.GetIds()) {
+            hash_db.add_ids(id);
+        }
+    }
+
+    tc::PerfectHash GetPerfectHash(const transport_catalogue_serialize::PerfectHash& hash_db)
+    {
+        return tc::PerfectHash(hash_db.seed(),
+            std::vector<uint32_t>(hash_db.displacements().begin(), hash_db.displacements().end()),
+            std::vector<uint32_t>(hash_db.ids().begin(), hash_db.ids().end()));
+    }
+}
+
 transport_catalogue_serialize::TC serialization::CreateTC(const tc::TransportCatalogue& catalogue)
 {
     transport_catalogue_serialize::TC tc;
 
-    int i = 0;
-    // read Stops data from tc
+    // read Stops data from tc, index of stop in db is equal to its id
     for (const auto& stopData : catalogue.GetStops()) {
         // create stop object
         transport_catalogue_serialize::Stop stop;
@@ -17,7 +36,6 @@ transport_catalogue_serialize::TC serialization::CreateTC(const tc::TransportCat
         stop.set_longitude(stopData.longitude);
         // make setup stop to db
         *tc.mutable_stops()->Add() = std::move(stop);
-        ++i;
     }
 
     // read Buses data from tc
@@ -27,35 +45,45 @@ transport_catalogue_serialize::TC serialization::CreateTC(const tc::TransportCat
         bus.set_isring(busData->isRing);
         bus.set_namebus(busData->nameBus);
        
-        for (int j = 0; j < busData->ptr_ToStops.size(); ++j) {
-            // looking for index for each stop
-            std::optional<int> idStop = std::nullopt;
-            for (int k = 0; k < tc.stops().size(); ++k) {
-                if (busData->ptr_ToStops[j]->nameStop == tc.stops().operator[](k).namestop()) {
-                    idStop = k;
-                    break;
-                }
-            }
-            if (idStop.has_value()) {
-                *bus.mutable_ptrtostops()->Add() = idStop.value();
-            }
+        for (const domain::Stop* stop : busData->ptr_ToStops) {
+            bus.add_ptrtostops(static_cast<int>(stop->idStop));
         }
         // make setup bus to db
         *tc.mutable_buses()->Add() = std::move(bus);
     }
 
     // read Distances between stops
-    for (const auto& [stop, distance] : catalogue.GetAllDistances()) {
+    for (const tc::DistanceData& distData : catalogue.GetAllDistances()) {
         transport_catalogue_serialize::DistanceBetweenStop dist;
         // getting stop from
-        dist.set_firststop(stop.first->nameStop);
+        dist.set_firststop(std::string(distData.from));
         // declare stop to
-        dist.set_secondstop(stop.second->nameStop);
+        dist.set_secondstop(std::string(distData.to));
         // getting distance between stops
-        dist.set_distance(distance);
+        dist.set_distance(distData.distance);
         // make setup dist to db
         *tc.mutable_distbtwnstop()->Add() = std::move(dist);
     }
+
+    // read spatial index of stops
+    const tc::SpatialIndex& index = catalogue.GetSpatialIndex();
+    transport_catalogue_serialize::SpatialIndex& index_db = *tc.mutable_spatialindex();
+    index_db.set_minlatitude(index.GetGrid().min_lat);
+    index_db.set_minlongitude(index.GetGrid().min_lng);
+    index_db.set_celllatitude(index.GetGrid().cell_lat);
+    index_db.set_celllongitude(index.GetGrid().cell_lng);
+    index_db.set_rows(static_cast<uint32_t>(index.GetGrid().rows));
+    index_db.set_cols(static_cast<uint32_t>(index.GetGrid().cols));
+    for (const size_t offset : index.GetCellOffsets()) {
+        index_db.add_celloffsets(static_cast<uint32_t>(offset));
+    }
+    for (const size_t id : index.GetIds()) {
+        index_db.add_idstops(static_cast<uint32_t>(id));
+    }
+
+    // read hashes of names, ids of stops and buses are their indexes in db
+    SetPerfectHash(catalogue.GetStopHash(), *tc.mutable_stophash());
+    SetPerfectHash(catalogue.GetBusHash(), *tc.mutable_bushash());
     return tc;
 }
 
@@ -194,13 +222,15 @@ router_serialize::Router serialization::CreateRouter(const graph::TransportRoute
 void serialization::SerilalizeData(const std::filesystem::path& path, 
     const transport_catalogue_serialize::TC& obj_catalogue, 
     const render_settings_serialize::RenderSet& obj_rendSet,
-    const router_serialize::Router& obj_router)
+    const router_serialize::Router& obj_router,
+    const std::string& map)
 {
     std::ofstream out_file(path, std::ios::binary | std::ios::trunc);
     transport_catalogue_serialize::TCFull full_tc;
     *full_tc.mutable_tc_catalog() = obj_catalogue;
     *full_tc.mutable_render() = obj_rendSet;
     *full_tc.mutable_router() = obj_router;
+    full_tc.set_map(map);
 
     full_tc.SerializeToOstream(&out_file);
 }
@@ -232,50 +262,53 @@ std::optional<router_serialize::Router> serialization::DeserelizationRouter(std:
 void serialization::InitiliaziationTransportCatalogue(const std::optional<transport_catalogue_serialize::TC>& db,
     tc::TransportCatalogue& catalogue)
 {
-    // add stop to catalogue
-    for (int i = 0; i < db.value().stops().size(); ++i) {
-        // getting data for each stop from db
-        const transport_catalogue_serialize::Stop& s_data = db.value().stops().operator[](i);
-        // put stop data to catalogue
-        catalogue.AddStopToBase(s_data.namestop(), s_data.latitude(), s_data.longitude());
+    const transport_catalogue_serialize::TC& tc_db = db.value();
+
+    // collect stops, names are views on db data
+    std::vector<tc::StopData> stops;
+    stops.reserve(tc_db.stops().size());
+    for (const transport_catalogue_serialize::Stop& s_data : tc_db.stops()) {
+        stops.push_back({ s_data.namestop(), s_data.latitude(), s_data.longitude() });
     }
 
-    // add distances between stops to catalogue
-    for (int i = 0; i < db.value().distbtwnstop().size(); ++i) {
-        // getting data for each distance
-        const transport_catalogue_serialize::DistanceBetweenStop& d_data = db.value().distbtwnstop().operator[](i);
-        // getting ptr for first stop from catalogue
-        const domain::Stop* ptr_from = catalogue.SearchStop(d_data.firststop());
-        // getting ptr for second stop from catalogue
-        const domain::Stop* ptr_to = catalogue.SearchStop(d_data.secondstop());
-        // set distance to catalogue
-        catalogue.SetDistanceBetweenStops(std::make_pair(ptr_from, ptr_to), d_data.distance());
+    // collect distances between stops
+    std::vector<tc::DistanceData> distances;
+    distances.reserve(tc_db.distbtwnstop().size());
+    for (const transport_catalogue_serialize::DistanceBetweenStop& d_data : tc_db.distbtwnstop()) {
+        distances.push_back({ d_data.firststop(), d_data.secondstop(), d_data.distance() });
     }
 
-    // add route data to catalogue
-    for (int i = 0; i < db.value().buses().size(); ++i) {
-        // getting data for each bus
-        const transport_catalogue_serialize::Bus b_data = db.value().buses().operator[](i);
-        // declare list of stops on route
-        std::vector<std::string> routeStops;
-        routeStops.reserve(b_data.ptrtostops().size());
-        // getting ptr to stops
-        auto ptr_stops = b_data.ptrtostops();
-        // put stops data to container
-        for (int j = 0; j < ptr_stops.size(); ++j) {
-            // get index stop
-            int idStop = ptr_stops.operator[](j);
-            // get stop data from db
-            transport_catalogue_serialize::Stop s_data = db.value().stops().operator[](idStop);
-            // put stop to container
-            routeStops.push_back(s_data.namestop());
-        }
-        if (routeStops.empty()) {
+    // collect routes, db keeps full route as indexes of stops
+    std::vector<tc::BusData> buses;
+    buses.reserve(tc_db.buses().size());
+    for (const transport_catalogue_serialize::Bus& b_data : tc_db.buses()) {
+        if (b_data.ptrtostops().empty()) {
             continue;
         }
-        // put bus data to catalogue
-        catalogue.AddBus(db.value().buses().at(i).namebus(),
-            routeStops, b_data.isring());
+        tc::BusData bus{ b_data.namebus(), {}, b_data.isring() };
+        bus.routeStops.reserve(b_data.ptrtostops().size());
+        for (const int idStop : b_data.ptrtostops()) {
+            bus.routeStops.push_back(tc_db.stops(idStop).namestop());
+        }
+        buses.push_back(std::move(bus));
+    }
+
+    // put all data to catalogue, hashes of names from old or broken base are built again
+    catalogue.SetNameHashes(GetPerfectHash(tc_db.stophash()), GetPerfectHash(tc_db.bushash()));
+    catalogue.LoadBase(stops, distances, buses);
+
+    // restore spatial index of stops, old or broken base gets new one
+    const transport_catalogue_serialize::SpatialIndex& index_db = tc_db.spatialindex();
+    tc::GridParams grid{ index_db.minlatitude(), index_db.minlongitude(),
+        index_db.celllatitude(), index_db.celllongitude(), index_db.rows(), index_db.cols() };
+    std::vector<size_t> cellOffsets(index_db.celloffsets().begin(), index_db.celloffsets().end());
+    std::vector<size_t> ids(index_db.idstops().begin(), index_db.idstops().end());
+    if (tc_db.has_spatialindex() && tc::SpatialIndex::IsValid(grid, cellOffsets, ids, stops.size())) {
+        catalogue.SetSpatialIndex(tc::SpatialIndex(grid, std::move(cellOffsets), std::move(ids),
+            catalogue.GetStopsCoordinates()));
+    }
+    else {
+        catalogue.BuildSpatialIndex();
     }
 }
 
@@ -346,6 +379,7 @@ void serialization::InitializationRouter(const std::optional<router_serialize::R
     }
     // set stop ids to transport router
     tr.SetStopIds(std::move(stop_ids));
+    tr.SetRoutingSettings(velocity, bus_wait_time);
 }
 
 void serialization::SetColorSetting(const svg_serialize::Color& c_data, renderer::Settings& settings)
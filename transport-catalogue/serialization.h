@@ -27,7 +27,8 @@ namespace serialization {
 	void SerilalizeData(const std::filesystem::path& path,
 		const transport_catalogue_serialize::TC& obj_catalogue, 
 		const render_settings_serialize::RenderSet& obj_rendSet,
-		const router_serialize::Router& obj_router);
+		const router_serialize::Router& obj_router,
+		const std::string& map = {});
 
     std::optional<transport_catalogue_serialize::TCFull> Deserelization (const std::filesystem::path& path);
 
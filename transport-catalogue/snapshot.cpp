@@ -0,0 +1,196 @@
+#include "snapshot.h"
+#include "profile.h"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace snapshot {
+
+	namespace {
+		profile::Probe buildRouterProbe{ "build router" };
+
+		// graph depends on buses and distances, stops without buses are not in graph
+		bool ChangesRoutes(const tc::CatalogueUpdate& update)
+		{
+			return !update.buses.empty() || !update.removedBuses.empty()
+				|| !update.distances.empty() || !update.removedStops.empty();
+		}
+
+		bool HasBuses(const tc::TransportCatalogue& catalogue, std::string_view nameStop)
+		{
+			const std::optional<tc::StopBuses> buses = catalogue.GetStopToBuses(nameStop);
+			return buses && buses->begin() != buses->end();
+		}
+
+		// bus sent again with the same route keeps its edges
+		bool IsSameRoute(const domain::Bus& lhs, const domain::Bus& rhs)
+		{
+			return lhs.isRing == rhs.isRing && std::equal(lhs.ptr_ToStops.begin(), lhs.ptr_ToStops.end(),
+				rhs.ptr_ToStops.begin(), rhs.ptr_ToStops.end(), [](const domain::Stop* lhs, const domain::Stop* rhs) {
+					return lhs->idStop == rhs->idStop;
+				});
+		}
+
+		// buses of update when it only adds buses and stops: edges of old buses are the same,
+		// so graph of base is extended by them. Nullopt if graph must be built again
+		std::optional<std::vector<const domain::Bus*>> FindAddedBuses(const tc::TransportCatalogue& base,
+			const tc::TransportCatalogue& next, const tc::CatalogueUpdate& update)
+		{
+			const auto isChanged = [&base, &next](std::string_view nameBus) {
+				const domain::Bus* old = base.SearchRoute(nameBus);
+				const domain::Bus* bus = next.SearchRoute(nameBus);
+				return old != nullptr && (bus == nullptr || !IsSameRoute(*old, *bus));
+			};
+			if (std::any_of(update.removedBuses.begin(), update.removedBuses.end(), isChanged)
+				|| std::any_of(update.buses.begin(), update.buses.end(), [&isChanged](const tc::BusData& bus) {
+					return isChanged(bus.nameBus);
+				})
+				|| std::any_of(update.removedStops.begin(), update.removedStops.end(), [&base](std::string_view name) {
+					return HasBuses(base, name);
+				})) {
+				return std::nullopt;
+			}
+
+			// distance changes time of old bus going between its stops
+			for (const tc::DistanceData& distance : update.distances) {
+				const domain::Stop* from = base.SearchStop(distance.from);
+				const domain::Stop* to = base.SearchStop(distance.to);
+				if (from == nullptr || to == nullptr) {
+					continue;
+				}
+				const tc::StopBuses buses = *base.GetStopToBuses(from);
+				for (const std::string_view nameBus : buses) {
+					const std::vector<const domain::Stop*>& stops = base.SearchRoute(nameBus)->ptr_ToStops;
+					for (std::size_t i = 1; i < stops.size(); ++i) {
+						const bool isBetween = (stops[i - 1] == from && stops[i] == to) || (stops[i - 1] == to && stops[i] == from);
+						if (isBetween && base.GetDistanceBetweenStops(stops[i - 1], stops[i])
+							!= next.GetDistanceBetweenStops(stops[i - 1], stops[i])) {
+							return std::nullopt;
+						}
+					}
+				}
+			}
+
+			// repeated bus of update is added once, in order of names as in full graph
+			std::map<std::string_view, const domain::Bus*> added;
+			for (const tc::BusData& bus : update.buses) {
+				if (base.SearchRoute(bus.nameBus) == nullptr) {
+					added.emplace(bus.nameBus, next.SearchRoute(bus.nameBus));
+				}
+			}
+			std::vector<const domain::Bus*> result;
+			result.reserve(added.size());
+			for (const auto& [name, bus] : added) {
+				result.push_back(bus);
+			}
+			return result;
+		}
+
+		// map is scaled by stops with buses and their coordinates, other stops are not on it
+		bool ChangesMap(const tc::TransportCatalogue& base, const tc::TransportCatalogue& next,
+			const tc::CatalogueUpdate& update)
+		{
+			return !update.buses.empty() || !update.removedBuses.empty()
+				|| std::any_of(update.stops.begin(), update.stops.end(), [&next](const tc::StopData& stop) {
+					return HasBuses(next, stop.nameStop);
+				})
+				|| std::any_of(update.removedStops.begin(), update.removedStops.end(), [&base](std::string_view name) {
+					return HasBuses(base, name);
+				});
+		}
+	}
+
+	void MapCache::Set(std::string text)
+	{
+		std::call_once(once_, [this, &text]() {
+			text_ = std::move(text);
+		});
+	}
+
+	const std::string& MapCache::Get(const std::function<std::string()>& render) const
+	{
+		std::call_once(once_, [this, &render]() {
+			text_ = render();
+		});
+		return text_;
+	}
+
+	std::shared_ptr<const renderer::MapRenderer> MakeRenderer(const tc::TransportCatalogue& catalogue,
+		const renderer::Settings& settings)
+	{
+		// map is scaled by all stops with buses
+		const std::vector<domain::Stop> stops = catalogue.GetSortedStops();
+		auto render = std::make_shared<renderer::MapRenderer>(stops.begin(), stops.end(),
+			settings.width, settings.height, settings.padding);
+		render->SaveSettings(settings);
+		return render;
+	}
+
+	std::shared_ptr<const Snapshot> MakeSnapshot(std::shared_ptr<const tc::TransportCatalogue> catalogue,
+		std::shared_ptr<const graph::TransportGraph> graph, const renderer::Settings& settings,
+		std::string map)
+	{
+		auto result = std::make_shared<Snapshot>();
+		result->version = 1;
+		if (!map.empty()) {
+			result->map.Set(std::move(map));
+		}
+		result->renderer = MakeRenderer(*catalogue, settings);
+		{
+			profile::Scope scope(buildRouterProbe);
+			result->router = std::make_shared<const graph::TransportRouter>(*graph);
+		}
+		result->graph = std::move(graph);
+		result->catalogue = std::move(catalogue);
+		return result;
+	}
+
+	SnapshotStore::SnapshotStore(std::shared_ptr<const Snapshot> first)
+		: current_(std::move(first))
+	{
+	}
+
+	std::shared_ptr<const Snapshot> SnapshotStore::Acquire() const
+	{
+		return std::atomic_load(&current_);
+	}
+
+	std::shared_ptr<const Snapshot> SnapshotStore::Update(const tc::CatalogueUpdate& update)
+	{
+		std::lock_guard<std::mutex> guard(writer_);
+		const std::shared_ptr<const Snapshot> base = Acquire();
+
+		auto next = std::make_shared<Snapshot>();
+		next->version = base->version + 1;
+		next->catalogue = std::make_shared<const tc::TransportCatalogue>(*base->catalogue, update);
+		next->graph = base->graph;
+		next->router = base->router;
+		if (ChangesRoutes(update)) {
+			// routes between all stops are expensive: they are kept if graph is the same
+			// and extended if update only adds to it, then graph of base is extended too
+			const std::optional<std::vector<const domain::Bus*>> added
+				= FindAddedBuses(*base->catalogue, *next->catalogue, update);
+			if (!added) {
+				auto graph = std::make_shared<const graph::TransportGraph>(*next->catalogue,
+					base->graph->GetVelocity(), base->graph->GetWaitTime());
+				profile::Scope scope(buildRouterProbe);
+				next->router = std::make_shared<const graph::TransportRouter>(*graph);
+				next->graph = std::move(graph);
+			}
+			else if (!added->empty()) {
+				auto graph = std::make_shared<const graph::TransportGraph>(*base->graph, *next->catalogue, *added);
+				profile::Scope scope(buildRouterProbe);
+				next->router = std::make_shared<const graph::TransportRouter>(*graph, *base->router);
+				next->graph = std::move(graph);
+			}
+		}
+		next->renderer = ChangesMap(*base->catalogue, *next->catalogue, update)
+			? MakeRenderer(*next->catalogue, base->renderer->GetSettings()) : base->renderer;
+
+		std::shared_ptr<const Snapshot> result = std::move(next);
+		std::atomic_store(&current_, result);
+		return result;
+	}
+}
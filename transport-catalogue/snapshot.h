@@ -0,0 +1,64 @@
+#pragma once
+#include "transport_catalogue.h"
+#include "map_renderer.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace snapshot {
+
+	// map of version is the same for all requests, so it's rendered by the first
+	// of them or loaded from base, and kept as SVG escaped to JSON string
+	class MapCache {
+	public:
+		// text rendered beforehand, render passed to Get is not called then
+		void Set(std::string text);
+		// readers of version may call it at once, only one of them renders
+		const std::string& Get(const std::function<std::string()>& render) const;
+
+	private:
+		mutable std::once_flag once_;
+		mutable std::string text_;
+	};
+
+	// immutable state served to readers, reader keeps version alive while answers queries
+	struct Snapshot {
+		std::uint64_t version{ 0 };
+		std::shared_ptr<const tc::TransportCatalogue> catalogue;
+		// router refers to graph, so graph is declared first and destroyed last
+		std::shared_ptr<const graph::TransportGraph> graph;
+		std::shared_ptr<const graph::TransportRouter> router;
+		std::shared_ptr<const renderer::MapRenderer> renderer;
+		MapCache map;
+	};
+
+	// renderer scaled by all stops with buses of catalogue
+	std::shared_ptr<const renderer::MapRenderer> MakeRenderer(const tc::TransportCatalogue& catalogue,
+		const renderer::Settings& settings);
+
+	// first version made of loaded catalogue and graph, map is given if it was saved in base
+	std::shared_ptr<const Snapshot> MakeSnapshot(std::shared_ptr<const tc::TransportCatalogue> catalogue,
+		std::shared_ptr<const graph::TransportGraph> graph, const renderer::Settings& settings,
+		std::string map = {});
+
+	// holder of current version, readers take it without locks,
+	// writers are serialized and publish new version atomically
+	class SnapshotStore {
+	public:
+		explicit SnapshotStore(std::shared_ptr<const Snapshot> first);
+
+		std::shared_ptr<const Snapshot> Acquire() const;
+		// apply update to current version and publish result, readers of old version
+		// are not affected. Graph, router and renderer are shared if update doesn't change
+		// them, routes are extended instead of built again if update only adds to graph
+		std::shared_ptr<const Snapshot> Update(const tc::CatalogueUpdate& update);
+
+	private:
+		std::shared_ptr<const Snapshot> current_;
+		std::mutex writer_;
+	};
+}
@@ -0,0 +1,302 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace tc
+{
+	// target number of stops in one cell
+	static const double stopsPerCell = 2.0;
+	// length of one degree of latitude in meters
+	static const double metersPerDegree = 6'371'000 * M_PI / 180.;
+	static const double dr = M_PI / 180.;
+
+	SpatialIndex::SpatialIndex(const std::vector<geo::Coordinates>& points)
+	{
+		if (points.empty()) {
+			return;
+		}
+		auto cells = std::make_shared<Cells>();
+		GridParams& grid = cells->grid;
+		const auto [bottom_it, top_it] = std::minmax_element(points.begin(), points.end(),
+			[](const geo::Coordinates& lhs, const geo::Coordinates& rhs) { return lhs.lat < rhs.lat; });
+		const auto [left_it, right_it] = std::minmax_element(points.begin(), points.end(),
+			[](const geo::Coordinates& lhs, const geo::Coordinates& rhs) { return lhs.lng < rhs.lng; });
+		grid.min_lat = bottom_it->lat;
+		grid.min_lng = left_it->lng;
+
+		// degree of longitude is shorter than degree of latitude by cos(lat)
+		const double lngScale = std::max(std::cos((bottom_it->lat + top_it->lat) / 2 * dr), 0.01);
+		const double height = top_it->lat - bottom_it->lat;
+		const double width = (right_it->lng - left_it->lng) * lngScale;
+		const double numCells = std::max(1.0, points.size() / stopsPerCell);
+
+		// cells are square of equal area, but not smaller than long side split by numCells:
+		// nearly flat extent would get huge number of empty cells otherwise. Grid has
+		// at most numCells rows and columns by long side and numCells cells by area
+		double cellSize = std::max(std::sqrt(height * width / numCells), std::max(height, width) / numCells);
+		if (!(cellSize > 0)) {
+			cellSize = 1.0;
+		}
+		grid.cell_lat = cellSize;
+		grid.cell_lng = cellSize / lngScale;
+		grid.rows = static_cast<std::size_t>(height / grid.cell_lat) + 1;
+		grid.cols = static_cast<std::size_t>((right_it->lng - left_it->lng) / grid.cell_lng) + 1;
+		cells_ = cells;
+
+		// count stops of each cell and turn counters to offsets
+		std::vector<std::size_t> cellOf(points.size());
+		std::vector<std::size_t>& offsets = cells->offsets;
+		offsets.assign(grid.rows * grid.cols + 1, 0);
+		for (std::size_t id = 0; id < points.size(); ++id) {
+			cellOf[id] = GetRow(points[id].lat) * grid.cols + GetCol(points[id].lng);
+			++offsets[cellOf[id] + 1];
+		}
+		for (std::size_t i = 1; i < offsets.size(); ++i) {
+			offsets[i] += offsets[i - 1];
+		}
+
+		// put stops to their cells
+		cells->ids.resize(points.size());
+		std::vector<std::size_t> position(offsets.begin(), offsets.end() - 1);
+		for (std::size_t id = 0; id < points.size(); ++id) {
+			cells->ids[position[cellOf[id]]++] = id;
+		}
+		cells->points = MakePoints(cells->ids, points);
+		SetBounds();
+	}
+
+	SpatialIndex::SpatialIndex(const GridParams& grid, std::vector<std::size_t> cellOffsets,
+		std::vector<std::size_t> ids, const std::vector<geo::Coordinates>& points)
+	{
+		auto cells = std::make_shared<Cells>();
+		cells->grid = grid;
+		cells->offsets = std::move(cellOffsets);
+		cells->ids = std::move(ids);
+		cells->points = MakePoints(cells->ids, points);
+		cells_ = std::move(cells);
+		SetBounds();
+	}
+
+	SpatialIndex::SpatialIndex(const SpatialIndex& base, const std::vector<std::pair<std::size_t, geo::Coordinates>>& moved)
+		: SpatialIndex(base)
+	{
+		if (cells_->grid.rows == 0) {
+			// base without stops has no cells, the only one is made for new stops
+			GridParams grid;
+			grid.rows = 1;
+			grid.cols = 1;
+			cells_ = std::make_shared<const Cells>(Cells{ grid, { 0, 0 }, {}, {} });
+			SetBounds();
+		}
+
+		// stop moved again replaces its previous new place, ids of moved are unique
+		std::vector<std::size_t> ids;
+		ids.reserve(moved.size());
+		for (const auto& [id, point] : moved) {
+			ids.push_back(id);
+		}
+		std::sort(ids.begin(), ids.end());
+		moved_.erase(std::remove_if(moved_.begin(), moved_.end(), [&ids](const MovedStop& stop) {
+			return std::binary_search(ids.begin(), ids.end(), stop.idStop);
+		}), moved_.end());
+
+		const GridParams& grid = cells_->grid;
+		for (const auto& [id, point] : moved) {
+			min_lat_ = std::min(min_lat_, point.lat);
+			max_lat_ = std::max(max_lat_, point.lat);
+			min_lng_ = std::min(min_lng_, point.lng);
+			max_lng_ = std::max(max_lng_, point.lng);
+			moved_.push_back({ GetRow(point.lat) * grid.cols + GetCol(point.lng), id, geo::ToUnitVector(point) });
+		}
+		std::sort(moved_.begin(), moved_.end(), [](const MovedStop& lhs, const MovedStop& rhs) {
+			return lhs.cell < rhs.cell;
+		});
+
+		moved_ids_.clear();
+		for (const MovedStop& stop : moved_) {
+			moved_ids_.push_back(stop.idStop);
+		}
+		std::sort(moved_ids_.begin(), moved_ids_.end());
+	}
+
+	std::vector<NearbyStop> SpatialIndex::FindNearest(geo::Coordinates center, double radius, std::size_t limit) const
+	{
+		std::vector<NearbyStop> result;
+		if ((cells_->ids.empty() && moved_.empty()) || !(radius >= 0)) {
+			return result;
+		}
+		const GridParams& grid = cells_->grid;
+
+		// rows covered by circle
+		const double radiusLat = radius / metersPerDegree;
+		const double minLat = center.lat - radiusLat;
+		const double maxLat = center.lat + radiusLat;
+		if (maxLat < min_lat_ || minLat > max_lat_) {
+			return result;
+		}
+		const std::size_t firstRow = GetRow(minLat);
+		const std::size_t lastRow = GetRow(maxLat);
+
+		// columns covered by circle, circle is the widest on latitude closest to pole.
+		// Part of circle beyond ±180 continues from the other side of antimeridian,
+		// so it covers two ranges of columns, ranges sharing columns are joined
+		std::pair<std::size_t, std::size_t> colRanges[2];
+		std::size_t numRanges = 0;
+		const double cosLat = std::cos(std::min(90.0, std::max(std::abs(minLat), std::abs(maxLat))) * dr);
+		if (cosLat > 1e-6 && radiusLat / cosLat < 180.0) {
+			const double radiusLng = radiusLat / cosLat;
+			auto addRange = [&](double west, double east) {
+				if (east < min_lng_ || west > max_lng_) {
+					return;
+				}
+				const std::size_t firstCol = GetCol(west);
+				const std::size_t lastCol = GetCol(east);
+				if (numRanges > 0 && firstCol <= colRanges[0].second + 1 && lastCol + 1 >= colRanges[0].first) {
+					colRanges[0] = { std::min(firstCol, colRanges[0].first), std::max(lastCol, colRanges[0].second) };
+					return;
+				}
+				colRanges[numRanges++] = { firstCol, lastCol };
+			};
+			addRange(center.lng - radiusLng, center.lng + radiusLng);
+			if (center.lng - radiusLng < -180.0) {
+				addRange(center.lng - radiusLng + 360.0, center.lng + radiusLng + 360.0);
+			}
+			else if (center.lng + radiusLng > 180.0) {
+				addRange(center.lng - radiusLng - 360.0, center.lng + radiusLng - 360.0);
+			}
+		}
+		else {
+			colRanges[numRanges++] = { 0, grid.cols - 1 };
+		}
+
+		// check every stop in covered cells, moved stops are checked at their new places
+		const geo::UnitVector from = geo::ToUnitVector(center);
+		auto check = [&result, &from, radius](std::size_t idStop, const geo::UnitVector& point) {
+			const double distance = geo::ComputeDistance(from, point);
+			if (distance <= radius) {
+				result.push_back({ idStop, distance });
+			}
+		};
+		for (std::size_t range = 0; range < numRanges; ++range) {
+			const auto [firstCol, lastCol] = colRanges[range];
+			for (std::size_t row = firstRow; row <= lastRow; ++row) {
+				const std::size_t firstCell = row * grid.cols + firstCol;
+				const std::size_t lastCell = row * grid.cols + lastCol;
+				for (std::size_t i = cells_->offsets[firstCell]; i < cells_->offsets[lastCell + 1]; ++i) {
+					const std::size_t id = cells_->ids[i];
+					if (moved_ids_.empty() || !std::binary_search(moved_ids_.begin(), moved_ids_.end(), id)) {
+						check(id, cells_->points[i]);
+					}
+				}
+				auto it = std::lower_bound(moved_.begin(), moved_.end(), firstCell,
+					[](const MovedStop& stop, std::size_t cell) { return stop.cell < cell; });
+				for (; it != moved_.end() && it->cell <= lastCell; ++it) {
+					check(it->idStop, it->point);
+				}
+			}
+		}
+
+		auto isCloser = [](const NearbyStop& lhs, const NearbyStop& rhs) {
+			return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.idStop < rhs.idStop);
+		};
+		if (limit != 0 && limit < result.size()) {
+			std::partial_sort(result.begin(), result.begin() + limit, result.end(), isCloser);
+			result.resize(limit);
+		}
+		else {
+			std::sort(result.begin(), result.end(), isCloser);
+		}
+		return result;
+	}
+
+	const GridParams& SpatialIndex::GetGrid() const
+	{
+		return cells_->grid;
+	}
+
+	const std::vector<std::size_t>& SpatialIndex::GetCellOffsets() const
+	{
+		return cells_->offsets;
+	}
+
+	const std::vector<std::size_t>& SpatialIndex::GetIds() const
+	{
+		return cells_->ids;
+	}
+
+	std::size_t SpatialIndex::GetNumMoved() const
+	{
+		return moved_.size();
+	}
+
+	void SpatialIndex::CountMemory(memory::Counter& counter) const
+	{
+		counter.AddShared(sizeof(Cells));
+		counter.AddVector(cells_->offsets);
+		counter.AddVector(cells_->ids);
+		counter.AddVector(cells_->points);
+		counter.AddVector(moved_);
+		counter.AddVector(moved_ids_);
+	}
+
+	bool SpatialIndex::IsValid(const GridParams& grid, const std::vector<std::size_t>& cellOffsets,
+		const std::vector<std::size_t>& ids, std::size_t numStops)
+	{
+		if (ids.size() != numStops || !(grid.cell_lat > 0) || !(grid.cell_lng > 0)) {
+			return false;
+		}
+		if (numStops == 0) {
+			return true;
+		}
+		if (grid.rows == 0 || grid.cols == 0 || cellOffsets.size() != grid.rows * grid.cols + 1
+			|| cellOffsets.front() != 0 || cellOffsets.back() != ids.size()
+			|| !std::is_sorted(cellOffsets.begin(), cellOffsets.end())) {
+			return false;
+		}
+		return std::all_of(ids.begin(), ids.end(), [numStops](std::size_t id) { return id < numStops; });
+	}
+
+	std::size_t SpatialIndex::GetRow(double lat) const
+	{
+		const GridParams& grid = cells_->grid;
+		const double row = std::floor((lat - grid.min_lat) / grid.cell_lat);
+		return static_cast<std::size_t>(std::clamp(row, 0.0, static_cast<double>(grid.rows - 1)));
+	}
+
+	std::size_t SpatialIndex::GetCol(double lng) const
+	{
+		const GridParams& grid = cells_->grid;
+		const double col = std::floor((lng - grid.min_lng) / grid.cell_lng);
+		return static_cast<std::size_t>(std::clamp(col, 0.0, static_cast<double>(grid.cols - 1)));
+	}
+
+	void SpatialIndex::SetBounds()
+	{
+		const GridParams& grid = cells_->grid;
+		if (cells_->ids.empty()) {
+			// bounds are set by moved stops only
+			min_lat_ = min_lng_ = std::numeric_limits<double>::infinity();
+			max_lat_ = max_lng_ = -std::numeric_limits<double>::infinity();
+			return;
+		}
+		min_lat_ = grid.min_lat;
+		max_lat_ = grid.min_lat + grid.cell_lat * grid.rows;
+		min_lng_ = grid.min_lng;
+		max_lng_ = grid.min_lng + grid.cell_lng * grid.cols;
+	}
+
+	std::vector<geo::UnitVector> SpatialIndex::MakePoints(const std::vector<std::size_t>& ids,
+		const std::vector<geo::Coordinates>& points)
+	{
+		std::vector<geo::UnitVector> result;
+		result.reserve(ids.size());
+		for (const std::size_t id : ids) {
+			result.push_back(geo::ToUnitVector(points[id]));
+		}
+		return result;
+	}
+}
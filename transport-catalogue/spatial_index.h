@@ -0,0 +1,92 @@
+#pragma once
+#include "geo.h"
+#include "memory_stats.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+	// stop found near some point
+	struct NearbyStop {
+		std::size_t idStop{ 0 };
+		double distance{ 0.0 }; // in meters
+	};
+
+	// uniform grid over coordinates, cells are about square in meters
+	struct GridParams {
+		double min_lat{ 0.0 };
+		double min_lng{ 0.0 };
+		double cell_lat{ 1.0 }; // height of cell in degrees
+		double cell_lng{ 1.0 }; // width of cell in degrees
+		std::size_t rows{ 0 };
+		std::size_t cols{ 0 };
+	};
+
+	class SpatialIndex {
+	public:
+		SpatialIndex() = default;
+		// build grid over points, index of point is id of stop
+		explicit SpatialIndex(const std::vector<geo::Coordinates>& points);
+		// restore saved grid, points are coordinates of stops by their ids
+		SpatialIndex(const GridParams& grid, std::vector<std::size_t> cellOffsets,
+			std::vector<std::size_t> ids, const std::vector<geo::Coordinates>& points);
+		// grid of base with stops added or moved after it, pairs of id of stop and its new place.
+		// Cells of base are shared, new places are kept aside sorted by the same cells
+		SpatialIndex(const SpatialIndex& base, const std::vector<std::pair<std::size_t, geo::Coordinates>>& moved);
+
+		// stops not farther than radius from center sorted by distance,
+		// limit equal to zero means all found stops
+		std::vector<NearbyStop> FindNearest(geo::Coordinates center, double radius, std::size_t limit) const;
+
+		// cells built over all stops at once, stops added or moved later are not in them
+		const GridParams& GetGrid() const;
+		const std::vector<std::size_t>& GetCellOffsets() const;
+		const std::vector<std::size_t>& GetIds() const;
+		// number of stops added or moved after cells were built
+		std::size_t GetNumMoved() const;
+		void CountMemory(memory::Counter& counter) const;
+
+		// check that saved grid matches number of stops
+		static bool IsValid(const GridParams& grid, const std::vector<std::size_t>& cellOffsets,
+			const std::vector<std::size_t>& ids, std::size_t numStops);
+
+	private:
+		// grid built over all stops at once, shared by versions made by updates
+		struct Cells {
+			GridParams grid;
+			// cell -> begin of its stops in ids, last item is end of storage
+			std::vector<std::size_t> offsets;
+			// ids of stops in order of cells
+			std::vector<std::size_t> ids;
+			// positions of stops in the same order as ids
+			std::vector<geo::UnitVector> points;
+		};
+
+		// stop added or moved after cells were built
+		struct MovedStop {
+			std::size_t cell{ 0 };
+			std::size_t idStop{ 0 };
+			geo::UnitVector point;
+		};
+
+		std::shared_ptr<const Cells> cells_ = std::make_shared<const Cells>();
+		// sorted by cells, stop out of grid is put to the nearest cell on its border
+		std::vector<MovedStop> moved_;
+		// sorted ids of moved_, their old places in cells are skipped
+		std::vector<std::size_t> moved_ids_;
+		// bounds of grid widened by moved stops out of it
+		double min_lat_{ 0.0 };
+		double max_lat_{ 0.0 };
+		double min_lng_{ 0.0 };
+		double max_lng_{ 0.0 };
+
+		std::size_t GetRow(double lat) const;
+		std::size_t GetCol(double lng) const;
+		void SetBounds();
+		static std::vector<geo::UnitVector> MakePoints(const std::vector<std::size_t>& ids,
+			const std::vector<geo::Coordinates>& points);
+	};
+}
@@ -54,8 +54,13 @@ namespace svg {
 
 	void Circle::RenderObject(const RenderContext& context) const {
 		auto& out = context.out;
-		out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-		out << "r=\""sv << radius_ << "\" "sv;
+		out << "<circle cx=\""sv;
+		format::WriteDouble(out, center_.x);
+		out << "\" cy=\""sv;
+		format::WriteDouble(out, center_.y);
+		out << "\" r=\""sv;
+		format::WriteDouble(out, radius_);
+		out << "\" "sv;
 		// Выводим атрибуты, унаследованные от PathProps
 		RenderAttrs(context.out);
 		out << "/>"sv;
@@ -109,12 +114,15 @@ namespace svg {
 				}
 
 				if (flag) {
-					out << "<polyline points=\""sv << p.x << ","sv << p.y;
+					out << "<polyline points=\""sv;
 					flag = false;
 				}
 				else {
-					out << " " << p.x << ","sv << p.y;
+					out << ' ';
 				}
+				format::WriteDouble(out, p.x);
+				out << ',';
+				format::WriteDouble(out, p.y);
 			}
 		}
 		out << "\" "sv;
@@ -185,9 +193,15 @@ namespace svg {
 		auto& out = context.out;
 		
 		// cast default features to SVG format
-		out << "<text x=\""sv << pos_.x << "\" y=\""sv << pos_.y
-			<< "\" dx=\""sv << offset_.x << "\" dy=\""sv << offset_.y
-			<< "\" font-size=\""sv << size_;
+		out << "<text x=\""sv;
+		format::WriteDouble(out, pos_.x);
+		out << "\" y=\""sv;
+		format::WriteDouble(out, pos_.y);
+		out << "\" dx=\""sv;
+		format::WriteDouble(out, offset_.x);
+		out << "\" dy=\""sv;
+		format::WriteDouble(out, offset_.y);
+		out << "\" font-size=\""sv << size_;
 
 		if (!font_family_.empty()) {
 			out << "\" font-family=\""sv << font_family_;
@@ -320,14 +334,16 @@ namespace svg {
 
 	void OstreamColorPrinter::operator()(Rgb rgb) const
 	{
-		out << "rgb("s << std::to_string(rgb.red) << ","s << std::to_string(rgb.green)
-			<< ","s << std::to_string(rgb.blue) << ")"s;
+		out << "rgb("sv << static_cast<int>(rgb.red) << ","sv << static_cast<int>(rgb.green)
+			<< ","sv << static_cast<int>(rgb.blue) << ")"sv;
 	}
 
 	void OstreamColorPrinter::operator()(Rgba rgba) const
 	{
-		out << "rgba("s << std::to_string(rgba.red) << ","s << std::to_string(rgba.green)
-			<< ","s << std::to_string(rgba.blue) << ","s << rgba.opacity << ")"s;
+		out << "rgba("sv << static_cast<int>(rgba.red) << ","sv << static_cast<int>(rgba.green)
+			<< ","sv << static_cast<int>(rgba.blue) << ","sv;
+		format::WriteDouble(out, rgba.opacity);
+		out << ")"sv;
 	}
 
 }  // namespace svg
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "format.h"
+
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -171,19 +173,19 @@ namespace svg {
 			using namespace std::literals;
 			
 			if (fill_color_) {
-				std::ostringstream strm;
-				std::visit(OstreamColorPrinter{ strm }, *fill_color_);
-				//out << " fill=\""sv << *fill_color_ << "\""sv;
-				out << " fill=\""sv << strm.str() << "\""sv;
+				out << " fill=\""sv;
+				std::visit(OstreamColorPrinter{ out }, *fill_color_);
+				out << "\""sv;
 			}
 			if (stroke_color_) {
-				std::ostringstream strm;
-				std::visit(OstreamColorPrinter{ strm }, *stroke_color_);
-				//out << " stroke=\""sv << *stroke_color_ << "\""sv;
-				out << " stroke=\""sv << strm.str() << "\""sv;
+				out << " stroke=\""sv;
+				std::visit(OstreamColorPrinter{ out }, *stroke_color_);
+				out << "\""sv;
 			}
 			if (stroke_width_) {
-				out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
+				out << " stroke-width=\""sv;
+				format::WriteDouble(out, *stroke_width_);
+				out << "\""sv;
 			}
 			if (line_cap_) {
 				out << " stroke-linecap=\""sv << *line_cap_ << "\""sv;
@@ -0,0 +1,69 @@
+#include "thread_pool.h"
+
+namespace pool
+{
+	ThreadPool::ThreadPool(std::size_t threads) {
+		if (threads > 1) {
+			workers_.reserve(threads - 1);
+		}
+		for (std::size_t worker = 1; worker < threads; ++worker) {
+			workers_.emplace_back([this] {
+				Work();
+			});
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard lock(mutex_);
+			stop_ = true;
+		}
+		start_.notify_all();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	std::size_t ThreadPool::GetSize() const {
+		return workers_.size() + 1;
+	}
+
+	void ThreadPool::Run(const std::function<void()>& job) {
+		{
+			std::lock_guard lock(mutex_);
+			job_ = &job;
+			running_ = workers_.size();
+			++generation_;
+		}
+		start_.notify_all();
+		job();
+		std::unique_lock lock(mutex_);
+		done_.wait(lock, [this] {
+			return running_ == 0;
+		});
+		job_ = nullptr;
+	}
+
+	void ThreadPool::Work() {
+		std::uint64_t generation = 0;
+		while (true) {
+			const std::function<void()>* job = nullptr;
+			{
+				std::unique_lock lock(mutex_);
+				start_.wait(lock, [this, generation] {
+					return stop_ || generation_ != generation;
+				});
+				if (stop_) {
+					return;
+				}
+				generation = generation_;
+				job = job_;
+			}
+			(*job)();
+			std::lock_guard lock(mutex_);
+			if (--running_ == 0) {
+				done_.notify_one();
+			}
+		}
+	}
+}
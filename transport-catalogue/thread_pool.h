@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pool
+{
+	// threads started once and reused by every parallel loop instead of starting
+	// own threads for each of them. Current thread is one of threads of pool
+	class ThreadPool {
+	public:
+		explicit ThreadPool(std::size_t threads);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool();
+
+		std::size_t GetSize() const;
+
+		// calls task(i) for i in [0, count), free threads take them one by one.
+		// Error of task is thrown after all threads end the loop
+		template <typename Task>
+		void ForEach(std::size_t count, Task task);
+
+	private:
+		std::vector<std::thread> workers_;
+		std::mutex mutex_;
+		std::condition_variable start_;
+		std::condition_variable done_;
+		// job of current loop, each new loop increases generation
+		const std::function<void()>* job_ = nullptr;
+		std::uint64_t generation_{ 0 };
+		std::size_t running_{ 0 };
+		bool stop_{ false };
+
+		// job is run by all threads, returns when all of them end it
+		void Run(const std::function<void()>& job);
+		void Work();
+	};
+
+	template <typename Task>
+	void ThreadPool::ForEach(std::size_t count, Task task) {
+		std::atomic<std::size_t> next{ 0 };
+		std::mutex errorMutex;
+		std::exception_ptr error;
+		const std::function<void()> job = [&] {
+			try {
+				for (std::size_t i = next++; i < count; i = next++) {
+					task(i);
+				}
+			}
+			catch (...) {
+				std::lock_guard lock(errorMutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		};
+		if (count > 1 && !workers_.empty()) {
+			Run(job);
+		}
+		else {
+			job();
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
@@ -1,173 +1,579 @@
 #include "transport_catalogue.h"
 
 #include <algorithm>
+#include <cmath>
 #include <exception>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 
 namespace tc
 {
-	size_t HasherPtrStops::operator()(const std::pair<const domain::Stop*, const domain::Stop*> stop) const noexcept
-	{
-		size_t h_from = ptr_hasher(stop.first);
-		size_t h_to = ptr_hasher(stop.second);
-
-		return h_from + h_to * 37;
-	}
-
-	void TransportCatalogue::AddRouteToBase(const std::string& nameBus,
-		const std::vector<std::string>& orderStops, const bool typeRoute) {
-
-		domain::Bus bus(nameBus, typeRoute);
-		// define type of route
-		if (!bus.isRing) {
-			// assign end stop on route where bus change motion to back direction
-			bus.endStop = orderStops.back();
-			//resize vector of stops for reverse route
-			std::vector<std::string> tempVec = orderStops;
-			// put data in reverse direction except end vector of stops
-			for (auto it = (orderStops.rbegin() + 1); it != orderStops.rend(); it++) {
-				tempVec.push_back(*it);
-			}
-			// add all ptr to stops for reverse bus 
-			for (const std::string_view nameStop : tempVec) {
-				auto it_stop = stopname_to_stop_.find(nameStop);
-				bus.ptr_ToStops.push_back(it_stop->second);
-			}
-			// assign number of stops
-			bus.numStops = tempVec.size();
-			// assign number of unique stops
-			std::unordered_set<std::string_view> uniqueNames(tempVec.begin(), tempVec.end());
-			bus.numUniqueStops = uniqueNames.size();
-		}
-		else
-		{
-			// add all ptr to stops for ring bus
-			for (const std::string_view nameStop : orderStops) {
-				auto it_stop = stopname_to_stop_.find(nameStop);
-				bus.ptr_ToStops.push_back(it_stop->second);
-			}
-			// assign number of stops
-			bus.numStops = orderStops.size();
-			// assign number of unique stops
-			std::unordered_set<std::string_view> uniqueNames(orderStops.begin(), orderStops.end());
-			bus.numUniqueStops = uniqueNames.size();
-		}
-
-		// calculate length of route
-		bus.lengthRoute = ComputeLengthRoute(bus);
-
-		// calculate curvature of route
-		bus.curvature = ComputeCurvature(bus);
-
-		// put data to buses_
-		buses_.push_back(std::move(bus));
-		// put data to hash container
-		busname_to_bus_[nameBus] = (std::move(&buses_.back()));
-
-		// add number of buses on each stop
-		auto it_bus = busname_to_bus_.find(nameBus);
-		for (auto& ptr_stop : it_bus->second->ptr_ToStops) {
-			if (!stopname_to_buses_.count(ptr_stop)) {
+	// less buses than this are not worth own thread
+	static const std::size_t minBusesPerThread = 64;
+
+	std::vector<std::string_view> MakeFullRoute(const std::vector<std::string>& orderStops, const bool isRing)
+	{
+		return MakeFullRoute(std::vector<std::string_view>(orderStops.begin(), orderStops.end()), isRing);
+	}
+
+	std::vector<std::string_view> MakeFullRoute(std::vector<std::string_view> orderStops, const bool isRing)
+	{
+		if (!isRing && !orderStops.empty()) {
+			// put data in reverse direction except end stop
+			const std::size_t size = orderStops.size();
+			orderStops.reserve(size * 2 - 1);
+			for (std::size_t i = size - 1; i > 0; --i) {
+				orderStops.push_back(orderStops[i - 1]);
+			}
+		}
+		return orderStops;
+	}
+
+	namespace {
+		using Names = std::vector<std::pair<std::string_view, std::size_t>>;
+
+		// hash is usable if it leads each name to owner with the same name
+		template <typename IsOwner>
+		bool IsHashValid(const PerfectHash& hash, const Names& names, IsOwner isOwner) {
+			return std::all_of(names.begin(), names.end(), [&hash, &isOwner](const auto& name) {
+				const std::optional<std::size_t> id = hash.Find(name.first);
+				return id && isOwner(*id, name.first);
+			});
+		}
+
+		// names added after hash was built are checked first, hash leads them to other owners
+		std::optional<std::size_t> FindId(const PerfectHash& hash, const AddedNames& added, std::string_view name) {
+			if (!added.empty()) {
+				if (const auto it = added.find(name); it != added.end()) {
+					return it->second;
+				}
+			}
+			return hash.Find(name);
+		}
+
+		// changes of index kept aside cost about their number on each search, so index
+		// is built again when they are more than this
+		std::size_t MaxPatches(std::size_t size) {
+			return std::max<std::size_t>(64, static_cast<std::size_t>(std::sqrt(static_cast<double>(size))));
+		}
+
+		void SetDistance(StopDistances& distances, std::size_t to, unsigned int distance) {
+			auto it = std::lower_bound(distances.begin(), distances.end(), to,
+				[](const auto& item, std::size_t id) { return item.first < id; });
+			if (it != distances.end() && it->first == to) {
+				it->second = distance;
+			}
+			else {
+				distances.insert(it, { to, distance });
+			}
+		}
+	}
+
+	TransportCatalogue::TransportCatalogue(const TransportCatalogue& base, const CatalogueUpdate& update)
+		: TransportCatalogue(base)
+	{
+		// stops whose buses must be computed again
+		std::vector<std::size_t> changedStops;
+
+		// removed stop keeps its id and is hidden from all searches
+		if (!update.removedStops.empty()) {
+			auto removed = std::make_shared<std::vector<bool>>(*removed_stops_);
+			removed->resize(stops_.size(), false);
+			for (const std::string_view name : update.removedStops) {
+				const domain::Stop* stop = SearchStop(name);
+				if (stop == nullptr || (*removed)[stop->idStop]) {
+					continue;
+				}
+				(*removed)[stop->idStop] = true;
+				++num_removed_stops_;
+				distances_.Mutable(stop->idStop) = nullptr;
+				changedStops.push_back(stop->idStop);
+			}
+			removed_stops_ = std::move(removed);
+		}
+
+		// changed stop is replaced keeping its id, new stop is appended
+		std::unordered_map<std::string_view, std::size_t> added;
+		for (const StopData& data : update.stops) {
+			std::size_t id = stops_.size();
+			if (auto it = added.find(data.nameStop); it != added.end()) {
+				id = it->second;
+			}
+			else if (const domain::Stop* stop = SearchStop(data.nameStop)) {
+				// stop sent again on the same place changes nothing
+				if (stop->latitude == data.latitude && stop->longitude == data.longitude) {
+					continue;
+				}
+				id = stop->idStop;
+			}
+			else {
+				stops_.push_back(nullptr);
+				distances_.push_back(nullptr);
+				added[data.nameStop] = id;
+			}
+			auto stop = std::make_shared<domain::Stop>(std::string(data.nameStop), data.latitude, data.longitude);
+			stop->idStop = id;
+			stops_.Mutable(id) = std::move(stop);
+			changedStops.push_back(id);
+		}
+		std::sort(changedStops.begin(), changedStops.end());
+		changedStops.erase(std::unique(changedStops.begin(), changedStops.end()), changedStops.end());
+		if (!changedStops.empty()) {
+			PatchStops(changedStops, base.stops_.size());
+		}
+
+		// list of distances is copied once for all its changes
+		std::unordered_map<std::size_t, StopDistances> changedDistances;
+		for (const DistanceData& data : update.distances) {
+			const domain::Stop* from = SearchStop(data.from);
+			const domain::Stop* to = SearchStop(data.to);
+			if (from == nullptr || to == nullptr) {
 				continue;
 			}
-			stopname_to_buses_[ptr_stop].insert(it_bus->second->nameBus);
+			auto it = changedDistances.find(from->idStop);
+			if (it == changedDistances.end()) {
+				it = changedDistances.emplace(from->idStop, distances_[from->idStop]
+					? *distances_[from->idStop] : StopDistances{}).first;
+			}
+			SetDistance(it->second, to->idStop, data.distance);
+			changedStops.push_back(from->idStop);
+			changedStops.push_back(to->idStop);
 		}
+		for (auto& [id, distances] : changedDistances) {
+			distances_.Mutable(id) = std::make_shared<const StopDistances>(std::move(distances));
+		}
+
+		// buses of update and old buses passing through changed stops are computed,
+		// routes of old buses are views on stops of base which outlives this constructor
+		std::unordered_set<std::string_view> replaced(update.removedBuses.begin(), update.removedBuses.end());
+		std::vector<const BusData*> data;
+		for (const BusData& bus : update.buses) {
+			replaced.insert(bus.nameBus);
+			data.push_back(&bus);
+		}
+		std::sort(changedStops.begin(), changedStops.end());
+		changedStops.erase(std::unique(changedStops.begin(), changedStops.end()), changedStops.end());
+		std::vector<BusData> affected;
+		for (const std::size_t id : changedStops) {
+			if (id >= base.stops_.size()) {
+				continue;
+			}
+			for (const std::string_view name : base.GetBusesOfStop(id)) {
+				const domain::Bus* bus = base.SearchRoute(name);
+				if (!replaced.insert(bus->nameBus).second) {
+					continue;
+				}
+				BusData route{ bus->nameBus, {}, bus->isRing };
+				route.routeStops.reserve(bus->ptr_ToStops.size());
+				for (const domain::Stop* stop : bus->ptr_ToStops) {
+					route.routeStops.push_back(stop->nameStop);
+				}
+				affected.push_back(std::move(route));
+			}
+		}
+		for (const BusData& bus : affected) {
+			data.push_back(&bus);
+		}
+		if (data.empty() && update.removedBuses.empty()) {
+			return;
+		}
+		std::vector<domain::Bus> computed = ComputeBuses(std::move(data));
+
+		// changed bus keeps its id, new bus is appended
+		std::vector<std::size_t> changedBuses;
+		for (const std::string_view name : update.removedBuses) {
+			if (const std::optional<std::size_t> id = FindBus(name)) {
+				buses_[*id] = nullptr;
+				changedBuses.push_back(*id);
+			}
+		}
+		std::vector<std::pair<std::string_view, std::size_t>> newNames;
+		for (domain::Bus& bus : computed) {
+			const std::optional<std::size_t> found = FindBus(bus.nameBus);
+			const std::size_t id = found ? *found : buses_.size();
+			if (!found) {
+				buses_.emplace_back();
+			}
+			buses_[id] = std::make_shared<const domain::Bus>(std::move(bus));
+			if (!found) {
+				newNames.emplace_back(buses_[id]->nameBus, id);
+			}
+			changedBuses.push_back(id);
+		}
+		if (!newNames.empty()) {
+			if (added_bus_names_->size() + newNames.size() > MaxPatches(buses_.size())) {
+				bus_hash_ = std::make_shared<const PerfectHash>(GetBusNames());
+				added_bus_names_ = std::make_shared<const AddedNames>();
+			}
+			else {
+				auto addedNames = std::make_shared<AddedNames>(*added_bus_names_);
+				for (const auto& [name, id] : newNames) {
+					(*addedNames)[std::string(name)] = id;
+				}
+				added_bus_names_ = std::move(addedNames);
+			}
+		}
+		PatchStopToBuses(base, changedBuses);
 	}
 
-	void TransportCatalogue::AddBus(const std::string& nameBus, const std::vector<std::string>& routeStops, const bool typeRoute)
+	bool TransportCatalogue::IsRemoved(std::size_t idStop) const
 	{
-		domain::Bus bus(nameBus, typeRoute);
-		// add all ptr to stops for bus
-		bus.ptr_ToStops.reserve(routeStops.size());
-		for (const std::string_view nameStop : routeStops) {
-			auto it_stop = stopname_to_stop_.find(nameStop);
-			bus.ptr_ToStops.push_back(it_stop->second);
+		return idStop < removed_stops_->size() && (*removed_stops_)[idStop];
+	}
+
+	StopBuses TransportCatalogue::GetBusesOfStop(std::size_t idStop) const
+	{
+		if (!stop_buses_patches_->empty()) {
+			if (const auto it = stop_buses_patches_->find(idStop); it != stop_buses_patches_->end()) {
+				return StopBuses(it->second.begin(), it->second.end());
+			}
+		}
+		const std::vector<std::size_t>& offsets = stop_to_buses_->offsets;
+		auto begin = stop_to_buses_->names.begin();
+		// stop added after buses were frozen has no buses
+		if (idStop + 1 >= offsets.size()) {
+			return StopBuses(begin, begin);
 		}
-		// assign number of stops
-		bus.numStops = routeStops.size();
-		// assign number of unique stops
-		std::unordered_set<std::string_view> uniqueNames(routeStops.begin(), routeStops.end());
-		bus.numUniqueStops = uniqueNames.size();
+		return StopBuses(begin + offsets[idStop], begin + offsets[idStop + 1]);
+	}
 
+	std::vector<std::pair<std::string_view, std::size_t>> TransportCatalogue::GetStopNames() const
+	{
+		Names names;
+		names.reserve(stops_.size() - num_removed_stops_);
+		for (const auto& stop : stops_) {
+			if (!IsRemoved(stop->idStop)) {
+				names.emplace_back(stop->nameStop, stop->idStop);
+			}
+		}
+		return names;
+	}
 
-		// calculate length of route
-		bus.lengthRoute = ComputeLengthRoute(bus);
+	std::vector<std::pair<std::string_view, std::size_t>> TransportCatalogue::GetBusNames() const
+	{
+		Names names;
+		names.reserve(buses_.size());
+		for (std::size_t i = 0; i < buses_.size(); ++i) {
+			if (buses_[i]) {
+				names.emplace_back(buses_[i]->nameBus, i);
+			}
+		}
+		return names;
+	}
 
-		// calculate curvature of route
-		bus.curvature = ComputeCurvature(bus);
+	void TransportCatalogue::IndexStops()
+	{
+		stop_points_ = {};
+		for (const auto& stop : stops_) {
+			stop_points_.push_back(geo::ToUnitVector({ stop->latitude, stop->longitude }));
+		}
+
+		Names names = GetStopNames();
+		const bool isHashValid = IsHashValid(*stop_hash_, names, [this](std::size_t id, std::string_view name) {
+			return id < stops_.size() && !IsRemoved(id) && stops_[id]->nameStop == name;
+		});
+		if (!isHashValid) {
+			stop_hash_ = std::make_shared<const PerfectHash>(names);
+		}
+		added_stop_names_ = std::make_shared<const AddedNames>();
+		// sorted names of stops for search by part of name
+		stop_names_ = std::make_shared<const NameIndex>(std::move(names));
+	}
+
+	void TransportCatalogue::IndexBuses()
+	{
+		Names names = GetBusNames();
+		const bool isHashValid = IsHashValid(*bus_hash_, names, [this](std::size_t id, std::string_view name) {
+			return id < buses_.size() && buses_[id] && buses_[id]->nameBus == name;
+		});
+		if (!isHashValid) {
+			bus_hash_ = std::make_shared<const PerfectHash>(std::move(names));
+		}
+		added_bus_names_ = std::make_shared<const AddedNames>();
+		BuildStopToBuses();
+	}
+
+	void TransportCatalogue::BuildStopToBuses()
+	{
+		// buses are visited in order of names, then buses of each stop come sorted,
+		// last bus met on each stop, bus passing stop several times is counted once
+		std::vector<const domain::Bus*> sorted;
+		sorted.reserve(buses_.size());
+		for (const auto& bus : buses_) {
+			if (bus) {
+				sorted.push_back(bus.get());
+			}
+		}
+		std::sort(sorted.begin(), sorted.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) {
+			return lhs->nameBus < rhs->nameBus;
+		});
+		const std::size_t noBus = std::numeric_limits<std::size_t>::max();
+		std::vector<std::size_t> lastBus(stops_.size(), noBus);
+
+		// count buses of each stop and turn counters to offsets
+		auto stopToBuses = std::make_shared<StopToBuses>();
+		std::vector<std::size_t>& offsets = stopToBuses->offsets;
+		offsets.assign(stops_.size() + 1, 0);
+		for (std::size_t i = 0; i < sorted.size(); ++i) {
+			for (const domain::Stop* stop : sorted[i]->ptr_ToStops) {
+				if (lastBus[stop->idStop] != i) {
+					lastBus[stop->idStop] = i;
+					++offsets[stop->idStop + 1];
+				}
+			}
+		}
+		for (std::size_t i = 1; i < offsets.size(); ++i) {
+			offsets[i] += offsets[i - 1];
+		}
 
-		// put data to buses_
-		buses_.push_back(std::move(bus));
-		// put data to hash container
-		busname_to_bus_[nameBus] = (std::move(&buses_.back()));
+		// put names of buses to places of their stops
+		stopToBuses->names.assign(offsets.back(), std::string_view{});
+		std::vector<std::size_t> position(offsets.begin(), offsets.end() - 1);
+		lastBus.assign(stops_.size(), noBus);
+		for (std::size_t i = 0; i < sorted.size(); ++i) {
+			for (const domain::Stop* stop : sorted[i]->ptr_ToStops) {
+				if (lastBus[stop->idStop] != i) {
+					lastBus[stop->idStop] = i;
+					stopToBuses->names[position[stop->idStop]++] = sorted[i]->nameBus;
+				}
+			}
+		}
+		stop_to_buses_ = std::move(stopToBuses);
+		stop_buses_patches_ = std::make_shared<const StopBusesPatches>();
+	}
 
-		// add number of buses on each stop
-		auto it_bus = busname_to_bus_.find(nameBus);
-		for (auto& ptr_stop : it_bus->second->ptr_ToStops) {
-			if (!stopname_to_buses_.count(ptr_stop)) {
+	void TransportCatalogue::PatchStops(const std::vector<std::size_t>& changed, std::size_t firstNew)
+	{
+		// positions of changed stops are computed, others stay shared
+		stop_points_.resize(stops_.size());
+		std::vector<std::pair<std::size_t, geo::Coordinates>> moved;
+		Names names;
+		std::size_t numNew = 0;
+		for (const std::size_t id : changed) {
+			if (IsRemoved(id)) {
 				continue;
 			}
-			stopname_to_buses_[ptr_stop].insert(it_bus->second->nameBus);
+			const domain::Stop& stop = *stops_[id];
+			stop_points_.Mutable(id) = geo::ToUnitVector({ stop.latitude, stop.longitude });
+			moved.emplace_back(id, geo::Coordinates{ stop.latitude, stop.longitude });
+			names.emplace_back(stop.nameStop, id);
+			numNew += id >= firstNew ? 1 : 0;
+		}
+
+		// removed stops stay in grid and are skipped by search
+		const std::size_t maxPatches = MaxPatches(stops_.size());
+		if (spatial_index_->GetNumMoved() + moved.size() > maxPatches) {
+			BuildSpatialIndex();
 		}
+		else if (!moved.empty()) {
+			spatial_index_ = std::make_shared<const SpatialIndex>(*spatial_index_, moved);
+		}
+
+		if (numNew != 0) {
+			if (added_stop_names_->size() + numNew > maxPatches) {
+				stop_hash_ = std::make_shared<const PerfectHash>(GetStopNames());
+				added_stop_names_ = std::make_shared<const AddedNames>();
+			}
+			else {
+				auto addedNames = std::make_shared<AddedNames>(*added_stop_names_);
+				for (const auto& [name, id] : names) {
+					if (id >= firstNew) {
+						(*addedNames)[std::string(name)] = id;
+					}
+				}
+				added_stop_names_ = std::move(addedNames);
+			}
+		}
+
+		// names of changed stops are put again as moved stop has new string of name
+		stop_names_ = std::make_shared<const NameIndex>(*stop_names_, std::move(names), changed);
 	}
 
-	void TransportCatalogue::AddStopToBase(const std::string & nameStop,
-		const double& lat, const double& lon) {
+	void TransportCatalogue::PatchStopToBuses(const TransportCatalogue& base, const std::vector<std::size_t>& changed)
+	{
+		// stops of old and new routes of changed buses get lists of buses again:
+		// old list without changed buses and with buses of new routes
+		StopBusesPatches lists;
+		std::unordered_set<std::string_view> changedNames;
+		for (const std::size_t id : changed) {
+			if (id < base.buses_.size() && base.buses_[id]) {
+				changedNames.insert(base.buses_[id]->nameBus);
+				for (const domain::Stop* stop : base.buses_[id]->ptr_ToStops) {
+					lists[stop->idStop];
+				}
+			}
+		}
+		for (const std::size_t id : changed) {
+			if (buses_[id]) {
+				for (const domain::Stop* stop : buses_[id]->ptr_ToStops) {
+					lists[stop->idStop].push_back(buses_[id]->nameBus);
+				}
+			}
+		}
+		std::size_t numPatches = stop_buses_patches_->size();
+		for (auto& [idStop, names] : lists) {
+			for (const std::string_view name : GetBusesOfStop(idStop)) {
+				if (changedNames.count(name) == 0) {
+					names.push_back(name);
+				}
+			}
+			std::sort(names.begin(), names.end());
+			names.erase(std::unique(names.begin(), names.end()), names.end());
+			numPatches += stop_buses_patches_->count(idStop) == 0 ? 1 : 0;
+		}
 
-		domain::Stop stop(nameStop, lat, lon);
-		stops_.push_back(std::move(stop));
-		// insert to stopname_to_stop_
-		stopname_to_stop_[nameStop] = (std::move(&stops_.back()));
-		// put all ptr to stop to hash container stopName to buses
-		stopname_to_buses_[std::move(&stops_.back())];
+		if (numPatches > MaxPatches(stops_.size())) {
+			BuildStopToBuses();
+			return;
+		}
+		auto patches = std::make_shared<StopBusesPatches>(*stop_buses_patches_);
+		for (auto& [idStop, names] : lists) {
+			(*patches)[idStop] = std::move(names);
+		}
+		stop_buses_patches_ = std::move(patches);
 	}
 
-	void TransportCatalogue::SetDistanceBetweenStops(const std::pair<const domain::Stop*,
-		const domain::Stop*> towardStop, const int distance) {
+	void TransportCatalogue::SetThreads(std::size_t threads)
+	{
+		threads_ = std::max<std::size_t>(1, threads);
+	}
 
-		stops_to_distance_[towardStop] = static_cast<unsigned int>(distance);
+	void TransportCatalogue::SetNameHashes(PerfectHash&& stops, PerfectHash&& buses)
+	{
+		stop_hash_ = std::make_shared<const PerfectHash>(std::move(stops));
+		bus_hash_ = std::make_shared<const PerfectHash>(std::move(buses));
 	}
 
-	const domain::Bus* TransportCatalogue::SearchRoute(const std::string_view& nameBus) const
+	void TransportCatalogue::LoadBase(const std::vector<StopData>& stops,
+		const std::vector<DistanceData>& distances, const std::vector<BusData>& buses)
 	{
-		// search data about route
-		if (!busname_to_bus_.count(nameBus)) {
-			const domain::Bus* bus = nullptr;
-			return bus;
+		// put stops, id of stop is its index in stops_
+		for (const StopData& data : stops) {
+			auto stop = std::make_shared<domain::Stop>(std::string(data.nameStop), data.latitude, data.longitude);
+			stop->idStop = stops_.size();
+			stops_.push_back(std::move(stop));
+		}
+		IndexStops();
+
+		// put distances, skip unknown stops
+		std::vector<StopDistances> lists(stops_.size());
+		for (const DistanceData& data : distances) {
+			const domain::Stop* from = SearchStop(data.from);
+			const domain::Stop* to = SearchStop(data.to);
+			if (from == nullptr || to == nullptr) {
+				continue;
+			}
+			SetDistance(lists[from->idStop], to->idStop, data.distance);
 		}
-		return busname_to_bus_.at(nameBus);
+		distances_.resize(stops_.size());
+		for (std::size_t id = 0; id < lists.size(); ++id) {
+			if (!lists[id].empty()) {
+				distances_.Mutable(id) = std::make_shared<const StopDistances>(std::move(lists[id]));
+			}
+		}
+
+		// put buses, they are kept sorted by name so id of bus is the same in catalogue and in base
+		std::vector<const BusData*> data;
+		data.reserve(buses.size());
+		for (const BusData& bus : buses) {
+			data.push_back(&bus);
+		}
+		std::vector<domain::Bus> computed = ComputeBuses(std::move(data));
+		buses_.reserve(computed.size());
+		for (domain::Bus& bus : computed) {
+			buses_.push_back(std::make_shared<const domain::Bus>(std::move(bus)));
+		}
+		IndexBuses();
 	}
 
-	const domain::Stop* TransportCatalogue::SearchStop(const std::string_view& nameStop) const
+	std::vector<domain::Bus> TransportCatalogue::ComputeBuses(std::vector<const BusData*> data) const
 	{
-		if (!stopname_to_stop_.count(nameStop)) {
-			const domain::Stop* stop = nullptr;
-			return stop;
+		std::stable_sort(data.begin(), data.end(), [](const BusData* lhs, const BusData* rhs) {
+			return lhs->nameBus < rhs->nameBus;
+		});
+		auto repeated = std::unique(data.rbegin(), data.rend(), [](const BusData* lhs, const BusData* rhs) {
+			return lhs->nameBus == rhs->nameBus;
+		});
+		data.erase(data.begin(), repeated.base());
+
+		// statistics of each bus depends only on stops and distances,
+		// so buses are divided into chunks computed by own thread
+		std::vector<domain::Bus> result;
+		result.reserve(data.size());
+		for (const BusData* bus : data) {
+			result.emplace_back(std::string(bus->nameBus), bus->isRing);
 		}
-		return stopname_to_stop_.at(nameStop);
+		const std::size_t numThreads = std::max<std::size_t>(1, std::min<std::size_t>(
+			threads_, data.size() / minBusesPerThread));
+		const std::size_t chunk = (data.size() + numThreads - 1) / numThreads;
+		std::vector<std::thread> workers;
+		workers.reserve(numThreads);
+		for (std::size_t first = chunk; first < data.size(); first += chunk) {
+			const std::size_t last = std::min(first + chunk, data.size());
+			workers.emplace_back([this, &data, &result, first, last] {
+				ComputeBusesStat(data, result, first, last);
+			});
+		}
+		// first chunk is computed by current thread
+		ComputeBusesStat(data, result, 0, std::min(chunk, data.size()));
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		return result;
 	}
 
-	const std::unordered_set<std::string_view>* TransportCatalogue::GetStopToBuses(const std::string_view & nameStop) const
+	std::optional<std::size_t> TransportCatalogue::FindBus(std::string_view nameBus) const
 	{
-		const domain::Stop* stop = SearchStop(nameStop);
-		if (!stopname_to_buses_.count(stop)) {
-			return {};
+		// name out of base gets id of some other bus
+		const std::optional<std::size_t> id = FindId(*bus_hash_, *added_bus_names_, nameBus);
+		if (!id || *id >= buses_.size() || !buses_[*id] || buses_[*id]->nameBus != nameBus) {
+			return std::nullopt;
 		}
-		return &stopname_to_buses_.at(stop);
+		return id;
 	}
 
-	std::vector<domain::Stop> TransportCatalogue::GetSortedStops() const
+	const domain::Bus* TransportCatalogue::SearchRoute(const std::string_view& nameBus) const
+	{
+		const std::optional<std::size_t> id = FindBus(nameBus);
+		return id ? buses_[*id].get() : nullptr;
+	}
+
+	const domain::Stop* TransportCatalogue::SearchStop(const std::string_view& nameStop) const
+	{
+		// name out of base gets id of some other stop
+		const std::optional<std::size_t> id = FindId(*stop_hash_, *added_stop_names_, nameStop);
+		if (!id || *id >= stops_.size() || IsRemoved(*id) || stops_[*id]->nameStop != nameStop) {
+			return nullptr;
+		}
+		return stops_[*id].get();
+	}
+
+	std::optional<StopBuses> TransportCatalogue::GetStopToBuses(const std::string_view & nameStop) const
+	{
+		return GetStopToBuses(SearchStop(nameStop));
+	}
+
+	std::optional<StopBuses> TransportCatalogue::GetStopToBuses(const domain::Stop* stop) const
 	{
-		if (stopname_to_stop_.empty()) {
-			return {};
+		if (stop == nullptr) {
+			return std::nullopt;
 		}
+		return GetBusesOfStop(stop->idStop);
+	}
 
+	std::vector<domain::Stop> TransportCatalogue::GetSortedStops() const
+	{
 		std::vector<domain::Stop> result;
-		for (auto&[nameStop, dataStop] : stopname_to_stop_) {
-			if (GetStopToBuses(nameStop)->empty()) {
+		for (const auto& stop : stops_) {
+			// skip stop without buses, repeated or removed stop is skipped too as buses don't use it
+			const StopBuses buses = GetBusesOfStop(stop->idStop);
+			if (buses.begin() == buses.end()) {
 				continue;
 			}
-			result.push_back(*dataStop);
+			result.push_back(*stop);
 		}
 		return result;
 	}
@@ -175,24 +581,85 @@ namespace tc
 	std::vector<domain::Stop> TransportCatalogue::GetStops() const
 	{
 		std::vector<domain::Stop> result;
-		for (auto& [nameStop, dataStop] : stopname_to_stop_) {
-			
-			result.push_back(*dataStop);
+		result.reserve(stops_.size());
+		for (const auto& stop : stops_) {
+			if (!IsRemoved(stop->idStop)) {
+				result.push_back(*stop);
+			}
 		}
+		return result;
+	}
 
+	std::vector<geo::Coordinates> TransportCatalogue::GetStopsCoordinates() const
+	{
+		std::vector<geo::Coordinates> result;
+		result.reserve(stops_.size());
+		for (const auto& stop : stops_) {
+			result.push_back({ stop->latitude, stop->longitude });
+		}
 		return result;
 	}
 
-	const std::map< std::string_view, const domain::Bus*> TransportCatalogue::GetSortedBuses() const
+	void TransportCatalogue::BuildSpatialIndex()
+	{
+		spatial_index_ = std::make_shared<const SpatialIndex>(GetStopsCoordinates());
+	}
+
+	void TransportCatalogue::SetSpatialIndex(SpatialIndex&& index)
+	{
+		spatial_index_ = std::make_shared<const SpatialIndex>(std::move(index));
+	}
+
+	const SpatialIndex& TransportCatalogue::GetSpatialIndex() const
+	{
+		return *spatial_index_;
+	}
+
+	const PerfectHash& TransportCatalogue::GetStopHash() const
+	{
+		return *stop_hash_;
+	}
+
+	const PerfectHash& TransportCatalogue::GetBusHash() const
 	{
-		if (busname_to_bus_.empty()) {
-			return {};
+		return *bus_hash_;
+	}
+
+	std::vector<const domain::Stop*> TransportCatalogue::SearchStopsByName(std::string_view query,
+		std::size_t maxEdits, std::size_t limit) const
+	{
+		std::vector<const domain::Stop*> result;
+		for (const NameMatch& found : stop_names_->FindFuzzy(query, maxEdits, limit)) {
+			result.push_back(stops_[found.id].get());
 		}
+		return result;
+	}
 
+	std::vector<std::pair<const domain::Stop*, double>> TransportCatalogue::GetNearestStops(
+		geo::Coordinates center, double radius, std::size_t limit) const
+	{
+		// grid keeps removed stops, they can take not more than their number of places
+		const std::size_t wanted = limit == 0 ? 0 : limit + num_removed_stops_;
+		std::vector<std::pair<const domain::Stop*, double>> result;
+		for (const NearbyStop& found : spatial_index_->FindNearest(center, radius, wanted)) {
+			if (limit != 0 && result.size() == limit) {
+				break;
+			}
+			if (!IsRemoved(found.idStop)) {
+				result.emplace_back(stops_[found.idStop].get(), found.distance);
+			}
+		}
+		return result;
+	}
+
+	const std::map< std::string_view, const domain::Bus*> TransportCatalogue::GetSortedBuses() const
+	{
 		std::map< std::string_view, const domain::Bus*> result;
 
-		for (const auto&[busName, busData] : busname_to_bus_) {
-			result[busName] = busData;
+		for (const auto& bus : buses_) {
+			if (bus) {
+				result.emplace(bus->nameBus, bus.get());
+			}
 		}
 		
 		return result;
@@ -200,24 +667,129 @@ namespace tc
 	
 	unsigned int TransportCatalogue::GetDistanceBetweenStops(const domain::Stop* from, const domain::Stop* to) const
 	{
-		if (stops_to_distance_.count(std::make_pair(from, to))) {
-			return stops_to_distance_.at(std::make_pair(from, to));
+		if (const std::optional<unsigned int> distance = FindDistance(from->idStop, to->idStop)) {
+			return *distance;
 		}
 		// if in storage no key {from, to} reverse it to {to, from}
-		if (stops_to_distance_.count(std::make_pair(to, from))) {
-			return stops_to_distance_.at(std::make_pair(to, from));
+		if (const std::optional<unsigned int> distance = FindDistance(to->idStop, from->idStop)) {
+			return *distance;
 		}
 
 		return 0;
+	}
+
+	std::optional<unsigned int> TransportCatalogue::FindDistance(std::size_t from, std::size_t to) const
+	{
+		if (from >= distances_.size() || !distances_[from]) {
+			return std::nullopt;
+		}
+		const StopDistances& distances = *distances_[from];
+		auto it = std::lower_bound(distances.begin(), distances.end(), to,
+			[](const auto& item, std::size_t id) { return item.first < id; });
+		if (it == distances.end() || it->first != to) {
+			return std::nullopt;
+		}
+		return it->second;
+	}
 
+	std::vector<DistanceData> TransportCatalogue::GetAllDistances() const
+	{
+		std::vector<DistanceData> result;
+		for (std::size_t from = 0; from < distances_.size(); ++from) {
+			if (!distances_[from] || IsRemoved(from)) {
+				continue;
+			}
+			for (const auto& [to, distance] : *distances_[from]) {
+				if (!IsRemoved(to)) {
+					result.push_back({ stops_[from]->nameStop, stops_[to]->nameStop, distance });
+				}
+			}
+		}
+		return result;
 	}
 
-	const StorageStopsToDistance& TransportCatalogue::GetAllDistances() const
+	void TransportCatalogue::CollectMemory(memory::Report& report) const
 	{
-		return stops_to_distance_;
+		memory::Counter stops;
+		stops_.CountMemory(stops);
+		for (const auto& stop : stops_) {
+			stops.AddShared(sizeof(domain::Stop));
+			stops.AddString(stop->nameStop);
+		}
+		report.Add("catalogue.stops", stops_.size(), stops);
+
+		memory::Counter buses;
+		buses.AddVector(buses_);
+		std::size_t numBuses = 0;
+		for (const auto& bus : buses_) {
+			if (!bus) {
+				continue;
+			}
+			++numBuses;
+			buses.AddShared(sizeof(domain::Bus));
+			buses.AddString(bus->nameBus);
+			buses.AddString(bus->endStop);
+			buses.AddVector(bus->ptr_ToStops);
+		}
+		report.Add("catalogue.buses", numBuses, buses);
+
+		memory::Counter distances;
+		std::size_t numDistances = 0;
+		distances_.CountMemory(distances);
+		for (const auto& list : distances_) {
+			if (list) {
+				distances.AddShared(sizeof(StopDistances));
+				distances.AddVector(*list);
+				numDistances += list->size();
+			}
+		}
+		report.Add("catalogue.distances", numDistances, distances);
+
+		memory::Counter stopToBuses;
+		stopToBuses.AddShared(sizeof(StopToBuses));
+		stopToBuses.AddVector(stop_to_buses_->names);
+		stopToBuses.AddVector(stop_to_buses_->offsets);
+		// node of tree keeps three pointers and color besides item
+		stopToBuses.AddShared(sizeof(StopBusesPatches));
+		for (const auto& [idStop, names] : *stop_buses_patches_) {
+			stopToBuses.AddBlock(sizeof(void*) * 4 + sizeof(StopBusesPatches::value_type));
+			stopToBuses.AddVector(names);
+		}
+		report.Add("catalogue.stop_to_buses", stop_to_buses_->names.size(), stopToBuses);
+
+		memory::Counter points;
+		stop_points_.CountMemory(points);
+		points.AddShared(sizeof(std::vector<bool>));
+		points.AddVector(*removed_stops_);
+		report.Add("catalogue.stop_points", stop_points_.size(), points);
+
+		memory::Counter spatial;
+		spatial.AddShared(sizeof(SpatialIndex));
+		spatial_index_->CountMemory(spatial);
+		report.Add("catalogue.spatial_index", spatial_index_->GetIds().size(), spatial);
+
+		memory::Counter names;
+		names.AddShared(sizeof(NameIndex));
+		stop_names_->CountMemory(names);
+		report.Add("catalogue.name_index", stops_.size() - num_removed_stops_, names);
+
+		memory::Counter hashes;
+		hashes.AddShared(sizeof(PerfectHash));
+		stop_hash_->CountMemory(hashes);
+		hashes.AddShared(sizeof(PerfectHash));
+		bus_hash_->CountMemory(hashes);
+		for (const AddedNames* added : { added_stop_names_.get(), added_bus_names_.get() }) {
+			hashes.AddShared(sizeof(AddedNames));
+			for (const auto& item : *added) {
+				hashes.AddBlock(sizeof(void*) * 4 + sizeof(item));
+				hashes.AddString(item.first);
+			}
+		}
+		report.Add("catalogue.name_hashes", stop_hash_->Size() + bus_hash_->Size()
+			+ added_stop_names_->size() + added_bus_names_->size(), hashes);
 	}
 
-	double TransportCatalogue::ComputeLengthRoute(const domain::Bus bus)
+	double TransportCatalogue::ComputeLengthRoute(const domain::Bus& bus) const
 	{
 		double lengthRoute{ 0.0 };
 
@@ -230,30 +802,57 @@ namespace tc
 		return lengthRoute;
 	}
 
-	double TransportCatalogue::ComputeCurvature(const domain::Bus bus)
+	double TransportCatalogue::ComputeCurvature(const domain::Bus& bus, std::vector<geo::UnitVector>& points) const
 	{
-		double geoLengthRoute{ 0.0 };
-		geo::Coordinates prevCoord;
-		prevCoord.lat = 0.0;
-		prevCoord.lng = 0.0;
-		for (auto& ptr_stop : bus.ptr_ToStops) {
-			geo::Coordinates nextCoord;
-			nextCoord.lat = ptr_stop->latitude;
-			nextCoord.lng = ptr_stop->longitude;
-
-			if (prevCoord.lat == 0.0 && prevCoord.lng == 0.0) {
-				prevCoord.lat = nextCoord.lat;
-				prevCoord.lng = nextCoord.lng;
-				continue;
-			}
-			// calculate geographical length of route by coordinate
-			geoLengthRoute += ComputeDistance(prevCoord, nextCoord);
-			prevCoord.lat = nextCoord.lat;
-			prevCoord.lng = nextCoord.lng;
+		// gather precomputed positions of stops and calculate geographical length of route
+		points.clear();
+		for (const domain::Stop* ptr_stop : bus.ptr_ToStops) {
+			points.push_back(stop_points_[ptr_stop->idStop]);
 		}
+		const double geoLengthRoute = geo::ComputeRouteDistance(points.data(), points.size());
 
 		double curvature = bus.lengthRoute / geoLengthRoute;
 
 		return curvature;
 	}
+
+	void TransportCatalogue::ComputeBusesStat(const std::vector<const BusData*>& data,
+		std::vector<domain::Bus>& buses, std::size_t first, std::size_t last) const
+	{
+		// ids of stops of current route, sorted to count unique stops without hashing
+		std::vector<std::size_t> ids;
+		// coordinates of current route
+		std::vector<geo::UnitVector> points;
+
+		for (std::size_t i = first; i < last; ++i) {
+			domain::Bus& bus = buses[i];
+			// add all ptr to stops for bus, skip unknown stops
+			bus.ptr_ToStops.reserve(data[i]->routeStops.size());
+			ids.clear();
+			for (const std::string_view nameStop : data[i]->routeStops) {
+				const domain::Stop* stop = SearchStop(nameStop);
+				if (stop == nullptr) {
+					continue;
+				}
+				bus.ptr_ToStops.push_back(stop);
+				ids.push_back(stop->idStop);
+			}
+			std::sort(ids.begin(), ids.end());
+			bus.numUniqueStops = std::unique(ids.begin(), ids.end()) - ids.begin();
+			bus.numStops = bus.ptr_ToStops.size();
+			if (bus.ptr_ToStops.empty()) {
+				continue;
+			}
+			// end stop of not ring route is in the middle of full route
+			if (!bus.isRing) {
+				bus.endStop = bus.ptr_ToStops[bus.ptr_ToStops.size() / 2]->nameStop;
+			}
+
+			// calculate length of route
+			bus.lengthRoute = ComputeLengthRoute(bus);
+
+			// calculate curvature of route
+			bus.curvature = ComputeCurvature(bus, points);
+		}
+	}
 }
\ No newline at end of file
@@ -1,61 +1,184 @@
 #pragma once
 
+#include "chunked_vector.h"
 #include "domain.h"
+#include "geo.h"
+#include "memory_stats.h"
+#include "ranges.h"
+#include "name_index.h"
+#include "perfect_hash.h"
+#include "spatial_index.h"
 
-#include <queue>
+#include <functional>
+#include <memory>
+#include <string>
 #include <string_view>
-#include <unordered_map>
-#include <unordered_set>
 #include <tuple>
 #include <vector>
 #include <map>
+#include <optional>
 
 namespace tc
 {
 	using namespace std::literals;
 
-	struct HasherPtrStops {
-		size_t operator()(const std::pair<const domain::Stop*, const domain::Stop*> stop) const noexcept;
-	private:
-		std::hash<const void*> ptr_hasher;
+	// sorted names of buses passing through one stop
+	using StopBuses = ranges::Range<std::vector<std::string_view>::const_iterator>;
+	// distances from one stop as pairs of id of stop to and distance, sorted by ids
+	using StopDistances = std::vector<std::pair<std::size_t, unsigned int>>;
+	// name -> id for names added after hash of names was built
+	using AddedNames = std::map<std::string, std::size_t, std::less<>>;
+
+	// input records for bulk loading of base, names are views on caller's data
+	struct StopData {
+		std::string_view nameStop;
+		double latitude{ 0.0 };
+		double longitude{ 0.0 };
+	};
+
+	struct DistanceData {
+		std::string_view from;
+		std::string_view to;
+		unsigned int distance{ 0 };
 	};
 
-	using StorageBusNameToBus = std::unordered_map<std::string_view, const domain::Bus*>;
-	using StorageStopNameToStop = std::unordered_map<std::string_view, const domain::Stop*>;
-	using StorageStopNameToBuses = std::unordered_map<const domain::Stop*, std::unordered_set<std::string_view>>;
-	using StorageStopsToDistance = std::unordered_map<const std::pair<const domain::Stop*, const domain::Stop*>, unsigned int, HasherPtrStops>;
+	struct BusData {
+		std::string_view nameBus;
+		// full route, for not ring route contains both directions
+		std::vector<std::string_view> routeStops;
+		bool isRing{ false };
+	};
 
+	// changes of base applied at once, names are views on caller's data
+	struct CatalogueUpdate {
+		// new stops or new coordinates of existing ones
+		std::vector<StopData> stops;
+		// new or changed distances
+		std::vector<DistanceData> distances;
+		// new buses or new routes of existing ones
+		std::vector<BusData> buses;
+		// buses passing through removed stop lose it from their routes
+		std::vector<std::string_view> removedStops;
+		std::vector<std::string_view> removedBuses;
+	};
+
+	// make full route from stops of request, not ring route is completed by way back
+	std::vector<std::string_view> MakeFullRoute(const std::vector<std::string>& orderStops, const bool isRing);
+	std::vector<std::string_view> MakeFullRoute(std::vector<std::string_view> orderStops, const bool isRing);
+
+	// catalogue is not changed after loading, update makes new version which shares
+	// unchanged stops, buses and indexes with the old one
 	class TransportCatalogue
 	{
 	public:
-		void AddRouteToBase(const std::string& nameBus,
-			const std::vector<std::string>& orderStops, const bool typeRoute);
-		void AddBus(const std::string& nameBus,
-			const std::vector<std::string>& routeStops, const bool typeRoute);
-		void AddStopToBase(const std::string & nameStop,
-			const double& lat, const double& lon);
-		void SetDistanceBetweenStops(const std::pair<const domain::Stop*, const domain::Stop*>
-			towardStop, const int distance);
+		TransportCatalogue() = default;
+		// new version of base with update applied, base stays valid and unchanged
+		TransportCatalogue(const TransportCatalogue& base, const CatalogueUpdate& update);
+
+		// statistics of buses are computed by up to threads threads,
+		// versions made by update keep the number
+		void SetThreads(std::size_t threads);
+		// hashes of names restored from base, must be set before LoadBase,
+		// hash not matching loaded names is built again
+		void SetNameHashes(PerfectHash&& stops, PerfectHash&& buses);
+		// load all stops, distances and buses in one go into empty catalogue,
+		// statistics of buses are computed in parallel, buses of stops are frozen
+		void LoadBase(const std::vector<StopData>& stops, const std::vector<DistanceData>& distances,
+			const std::vector<BusData>& buses);
+		// grid over coordinates of stops, built at make_base or restored from base
+		void BuildSpatialIndex();
+		void SetSpatialIndex(SpatialIndex&& index);
 
 		const domain::Bus* SearchRoute(const std::string_view& nameBus) const;
 		const domain::Stop* SearchStop(const std::string_view& nameStop) const;
-		const std::unordered_set<std::string_view>* GetStopToBuses(const std::string_view& nameStop) const;
+		std::optional<StopBuses> GetStopToBuses(const std::string_view& nameStop) const;
+		// stop found by SearchStop, nullopt for nullptr
+		std::optional<StopBuses> GetStopToBuses(const domain::Stop* stop) const;
 		std::vector<domain::Stop> GetSortedStops() const;
+		// stops in order of their ids, removed stops are skipped
 		std::vector<domain::Stop> GetStops() const;
+		std::vector<geo::Coordinates> GetStopsCoordinates() const;
+		const SpatialIndex& GetSpatialIndex() const;
+		const PerfectHash& GetStopHash() const;
+		const PerfectHash& GetBusHash() const;
+		// stops not farther than radius in meters sorted by distance, limit 0 means no limit
+		std::vector<std::pair<const domain::Stop*, double>> GetNearestStops(geo::Coordinates center,
+			double radius, std::size_t limit) const;
+		// stops whose names start with query, with maxEdits > 0 allows typos in query,
+		// limit 0 means no limit
+		std::vector<const domain::Stop*> SearchStopsByName(std::string_view query,
+			std::size_t maxEdits, std::size_t limit) const;
 		unsigned int GetDistanceBetweenStops(const domain::Stop* from, const domain::Stop* to) const;
-		const StorageStopsToDistance& GetAllDistances() const;
+		std::vector<DistanceData> GetAllDistances() const;
 		const std::map< std::string_view, const domain::Bus*> GetSortedBuses() const;
+		// parts shared with other versions are counted too
+		void CollectMemory(memory::Report& report) const;
 
 
 	private:
-		std::deque<domain::Bus> buses_;
-		std::deque<domain::Stop> stops_;
-		StorageBusNameToBus busname_to_bus_;
-		StorageStopNameToStop stopname_to_stop_;
-		StorageStopNameToBuses stopname_to_buses_;
-		StorageStopsToDistance stops_to_distance_;
-
-		double ComputeLengthRoute(const domain::Bus bus);
-		double ComputeCurvature(const domain::Bus bus);
+		// sorted bus names of all stops laid out one after another
+		struct StopToBuses {
+			std::vector<std::string_view> names;
+			// stop id -> begin of its buses in names, last item is end of storage
+			std::vector<std::size_t> offsets;
+		};
+		// stop id -> sorted bus names of stop changed after StopToBuses was built
+		using StopBusesPatches = std::map<std::size_t, std::vector<std::string_view>>;
+
+		// id of stop is its index, removed stop keeps its place so ids never change.
+		// Arrays over stops are shared with other versions by chunks
+		chunked::Vector<std::shared_ptr<const domain::Stop>> stops_;
+		// id of bus is its index, loaded buses are sorted by names so ids are the same
+		// in catalogue and in base. Update keeps ids: changed bus keeps its place, new bus
+		// is appended and removed bus leaves empty pointer
+		std::vector<std::shared_ptr<const domain::Bus>> buses_;
+		// stop id -> distances from stop, empty pointer for stop without distances
+		chunked::Vector<std::shared_ptr<const StopDistances>> distances_;
+		// indexes are immutable and shared between versions until data they are built on change.
+		// Update doesn't build whole index again, its changes are kept aside in small patches
+		// until they become too many
+		std::shared_ptr<const std::vector<bool>> removed_stops_ = std::make_shared<const std::vector<bool>>();
+		std::size_t num_removed_stops_{ 0 };
+		std::shared_ptr<const StopToBuses> stop_to_buses_ = std::make_shared<const StopToBuses>();
+		std::shared_ptr<const StopBusesPatches> stop_buses_patches_ = std::make_shared<const StopBusesPatches>();
+		// stop id -> position of stop on unit sphere, precomputed for geographical lengths
+		chunked::Vector<geo::UnitVector> stop_points_;
+		std::shared_ptr<const SpatialIndex> spatial_index_ = std::make_shared<const SpatialIndex>();
+		std::shared_ptr<const NameIndex> stop_names_ = std::make_shared<const NameIndex>();
+		// name -> id of stop or bus, names added later are found in added names
+		std::shared_ptr<const PerfectHash> stop_hash_ = std::make_shared<const PerfectHash>();
+		std::shared_ptr<const PerfectHash> bus_hash_ = std::make_shared<const PerfectHash>();
+		std::shared_ptr<const AddedNames> added_stop_names_ = std::make_shared<const AddedNames>();
+		std::shared_ptr<const AddedNames> added_bus_names_ = std::make_shared<const AddedNames>();
+		std::size_t threads_{ 1 };
+
+		bool IsRemoved(std::size_t idStop) const;
+		// id of bus with name, nullopt for unknown or removed bus
+		std::optional<std::size_t> FindBus(std::string_view nameBus) const;
+		StopBuses GetBusesOfStop(std::size_t idStop) const;
+		// pairs of name and id of all stops or buses except removed ones
+		std::vector<std::pair<std::string_view, std::size_t>> GetStopNames() const;
+		std::vector<std::pair<std::string_view, std::size_t>> GetBusNames() const;
+		// rebuild indexes over stops after stops are loaded,
+		// restored hash is kept if it matches names
+		void IndexStops();
+		// rebuild indexes over buses after buses are loaded, restored hash is kept
+		// if it matches names, buses of each stop are frozen into sorted contiguous lists
+		void IndexBuses();
+		void BuildStopToBuses();
+		// patch indexes over stops for stops with given ids, sorted and unique, ids from
+		// firstNew are new stops
+		void PatchStops(const std::vector<std::size_t>& changed, std::size_t firstNew);
+		// patch lists of buses of stops of old and new routes of buses with given ids
+		void PatchStopToBuses(const TransportCatalogue& base, const std::vector<std::size_t>& changed);
+		// buses with statistics sorted by names, of repeated names the last bus is kept
+		std::vector<domain::Bus> ComputeBuses(std::vector<const BusData*> data) const;
+		std::optional<unsigned int> FindDistance(std::size_t from, std::size_t to) const;
+		double ComputeLengthRoute(const domain::Bus& bus) const;
+		// points is buffer for coordinates of route, reused between buses
+		double ComputeCurvature(const domain::Bus& bus, std::vector<geo::UnitVector>& points) const;
+		// fill stops, statistics and end stop of bus in range [first, last) of buses
+		void ComputeBusesStat(const std::vector<const BusData*>& data, std::vector<domain::Bus>& buses,
+			std::size_t first, std::size_t last) const;
 	};
 }
\ No newline at end of file
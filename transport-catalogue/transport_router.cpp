@@ -1,8 +1,14 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <limits>
+
 
 namespace graph {
 
+	// stop has no vertex in graph
+	static const graph::VertexId noVertex = std::numeric_limits<graph::VertexId>::max();
+
 	size_t HasherStops::operator()(const std::string& stopName) const noexcept
 	{
 		size_t h_str = ptr_hasher(stopName);
@@ -12,12 +18,28 @@ namespace graph {
 	   	  	
 	/********************************TransportGraph*****************************/
 	TransportGraph::TransportGraph(const tc::TransportCatalogue & db, double velocity, int waitTime)
-		:graph_(db.GetSortedStops().size() * 2)
+		:velocity_(velocity), waitTime_(waitTime)
 	{
-		SetVertex(waitTime, db.GetSortedStops());
+		SetVertex(db.GetSortedStops());
 		SetEdge(velocity, db);
 	}
 
+	TransportGraph::TransportGraph(const TransportGraph& base, const tc::TransportCatalogue& db,
+		const std::vector<const domain::Bus*>& addedBuses)
+		: TransportGraph(base)
+	{
+		for (const domain::Bus* bus : addedBuses) {
+			for (const domain::Stop* stop : bus->ptr_ToStops) {
+				if (!GetStopVertex(stop)) {
+					AddStopVertices(*stop);
+				}
+			}
+		}
+		for (const domain::Bus* bus : addedBuses) {
+			AddBusEdges(velocity_, db, *bus);
+		}
+	}
+
 	const graph::DirectedWeightedGraph<double>& TransportGraph::GetGraph() const
 	{
 		return graph_;
@@ -38,21 +60,103 @@ namespace graph {
 		stopIds_ = std::move(stop_ids);
 	}
 
-	void TransportGraph::SetVertex(int waitTime, const std::vector<domain::Stop>& stops)
+	void TransportGraph::SetRoutingSettings(double velocity, int waitTime)
+	{
+		velocity_ = velocity;
+		waitTime_ = waitTime;
+	}
+
+	double TransportGraph::GetVelocity() const
+	{
+		return velocity_;
+	}
+
+	int TransportGraph::GetWaitTime() const
+	{
+		return waitTime_;
+	}
+
+	void TransportGraph::BindStops(const tc::TransportCatalogue& db)
+	{
+		stopVertices_.clear();
+		for (const auto& [name, vertex] : stopIds_) {
+			const domain::Stop* stop = db.SearchStop(name);
+			if (stop == nullptr) {
+				continue;
+			}
+			if (stopVertices_.size() <= stop->idStop) {
+				stopVertices_.resize(stop->idStop + 1, noVertex);
+			}
+			stopVertices_[stop->idStop] = vertex;
+		}
+	}
+
+	std::optional<graph::VertexId> TransportGraph::GetStopVertex(const domain::Stop* stop) const
+	{
+		if (stop == nullptr || stop->idStop >= stopVertices_.size() || stopVertices_[stop->idStop] == noVertex) {
+			return std::nullopt;
+		}
+		return stopVertices_[stop->idStop];
+	}
+
+	void TransportGraph::CollectMemory(memory::Report& report) const
+	{
+		// capacities of graph containers are not visible, sizes are used instead
+		memory::Counter edges;
+		if (graph_.GetEdgeCount() != 0) {
+			edges.AddBlock(graph_.GetEdgeCount() * sizeof(graph::Edge<double>));
+		}
+		for (graph::EdgeId id = 0; id < graph_.GetEdgeCount(); ++id) {
+			edges.AddString(graph_.GetEdge(id).name);
+		}
+		report.Add("graph.edges", graph_.GetEdgeCount(), edges);
+
+		memory::Counter incidence;
+		if (graph_.GetVertexCount() != 0) {
+			incidence.AddBlock(graph_.GetVertexCount() * sizeof(std::vector<graph::EdgeId>));
+		}
+		for (graph::VertexId id = 0; id < graph_.GetVertexCount(); ++id) {
+			const auto edgeIds = graph_.GetIncidentEdges(id);
+			const std::size_t count = edgeIds.end() - edgeIds.begin();
+			if (count != 0) {
+				incidence.AddBlock(count * sizeof(graph::EdgeId));
+			}
+		}
+		report.Add("graph.incidence_lists", graph_.GetVertexCount(), incidence);
+
+		// node of hash table keeps pointer to next node, item and hash of key
+		memory::Counter stopIds;
+		stopIds.AddBlock(stopIds_.bucket_count() * sizeof(void*));
+		for (const auto& item : stopIds_) {
+			stopIds.AddBlock(sizeof(void*) + sizeof(item) + sizeof(std::size_t));
+			stopIds.AddString(item.first);
+		}
+		memory::Counter stopVertices;
+		stopVertices.AddVector(stopVertices_);
+		report.Add("graph.stop_ids", stopIds_.size(), stopIds);
+		report.Add("graph.stop_vertices", stopVertices_.size(), stopVertices);
+	}
+
+	void TransportGraph::SetVertex(const std::vector<domain::Stop>& stops)
 	{
-		graph::VertexId counterVertex{ 0 };
-		std::size_t span_count{ 0 };
 		// fill vertex with wating time to graph
 		for (const auto& s : stops) {
-			// init container by name stop FROM
-			//add vertex and weight( time from stop to stop) to graph
-			// first add two ids stops and wait time on stop, but second id will be even
-			stopIds_[s.nameStop] = counterVertex;
-			// put span count equal zero it means that on giving stop wait duration = 0 in during motion
-			graph_.AddEdge({ s.nameStop, span_count, counterVertex, ++counterVertex, (double)waitTime });
-			// increase counter
-			++counterVertex;
+			AddStopVertices(s);
+		}
+	}
+
+	void TransportGraph::AddStopVertices(const domain::Stop& stop)
+	{
+		// first add two ids stops and wait time on stop, but second id will be even
+		const graph::VertexId vertex = graph_.AddVertex();
+		graph_.AddVertex();
+		stopIds_[stop.nameStop] = vertex;
+		if (stopVertices_.size() <= stop.idStop) {
+			stopVertices_.resize(stop.idStop + 1, noVertex);
 		}
+		stopVertices_[stop.idStop] = vertex;
+		// put span count equal zero it means that on giving stop wait duration = 0 in during motion
+		graph_.AddEdge({ stop.nameStop, 0, vertex, vertex + 1, (double)waitTime_ });
 	}
 
 	void TransportGraph::SetEdge(double velocity, const tc::TransportCatalogue & db)
@@ -62,34 +166,39 @@ namespace graph {
 		// make link between stops where are distances
 		for (const auto&[nameBus, ptrBus] : busesSorted)
 		{
-			const std::vector<const domain::Stop*> ptrStops = ptrBus->ptr_ToStops;
-			size_t stops_count = ptrStops.size();
-			// start cycle and assign index [i] for vertex stop FROM
-			for (size_t i = 0; i < stops_count; ++i) {
-				// start cycle and assign index [j] for vertex stop TO
-				for (size_t j = i + 1; j < stops_count; ++j) {
-					// get pointer for each stop
-					const domain::Stop* stop_from = ptrStops[i];
-					const domain::Stop* stop_to = ptrStops[j];
-					// get vertex id for each stop
-					// vertex FROM
-					graph::VertexId from = stopIds_.at(stop_from->nameStop);
-					//vertex TO
-					graph::VertexId to = stopIds_.at(stop_to->nameStop);
-					// get distance between stops
-					unsigned int dist = 0;
-					for (size_t k = i + 1; k <= j; ++k) {
-						dist += db.GetDistanceBetweenStops(ptrStops[k - 1], ptrStops[k]);
-					}
-					// compute neccessary time in route from stop to another one stop(multiple distance to 1.0)
-					// km/h - > m / min     
-					// km * 1000 / 60
-					/*in minutes*/double timePath = dist * 1.0 / (velocity * 1000 / 60);
-					std::size_t span_count = j - i;
-					graph_.AddEdge({ ptrBus->nameBus, span_count, from + 1, to, timePath });
-					// verify condition
-					if (!ptrBus->isRing && stop_to->nameStop == ptrBus->endStop && j == stops_count / 2) break;
+			AddBusEdges(velocity, db, *ptrBus);
+		}
+	}
+
+	void TransportGraph::AddBusEdges(double velocity, const tc::TransportCatalogue& db, const domain::Bus& bus)
+	{
+		const std::vector<const domain::Stop*>& ptrStops = bus.ptr_ToStops;
+		size_t stops_count = ptrStops.size();
+		// start cycle and assign index [i] for vertex stop FROM
+		for (size_t i = 0; i < stops_count; ++i) {
+			// start cycle and assign index [j] for vertex stop TO
+			for (size_t j = i + 1; j < stops_count; ++j) {
+				// get pointer for each stop
+				const domain::Stop* stop_from = ptrStops[i];
+				const domain::Stop* stop_to = ptrStops[j];
+				// get vertex id for each stop
+				// vertex FROM
+				graph::VertexId from = stopVertices_[stop_from->idStop];
+				//vertex TO
+				graph::VertexId to = stopVertices_[stop_to->idStop];
+				// get distance between stops
+				unsigned int dist = 0;
+				for (size_t k = i + 1; k <= j; ++k) {
+					dist += db.GetDistanceBetweenStops(ptrStops[k - 1], ptrStops[k]);
 				}
+				// compute neccessary time in route from stop to another one stop(multiple distance to 1.0)
+				// km/h - > m / min     
+				// km * 1000 / 60
+				/*in minutes*/double timePath = dist * 1.0 / (velocity * 1000 / 60);
+				std::size_t span_count = j - i;
+				graph_.AddEdge({ bus.nameBus, span_count, from + 1, to, timePath });
+				// verify condition
+				if (!bus.isRing && stop_to->nameStop == bus.endStop && j == stops_count / 2) break;
 			}
 		}
 	}
@@ -97,15 +206,22 @@ namespace graph {
 	TransportRouter::TransportRouter(const TransportGraph& makedGraph)
 		: graph::Router<double>(makedGraph.GetGraph()), makedGraph_(makedGraph)
 	{
-		ptrRoute_ = std::make_unique<graph::Router<double>>(makedGraph.GetGraph());
+	}
+
+	TransportRouter::TransportRouter(const TransportGraph& makedGraph, const TransportRouter& base)
+		: graph::Router<double>(makedGraph.GetGraph(), base), makedGraph_(makedGraph)
+	{
 	}
 
 	const TransportGraph & TransportRouter::GetMakedGraph() const
 	{
 		return makedGraph_;
 	}
-	const std::unique_ptr<graph::Router<double>>& TransportRouter::GetPtrRoute() const
+	void TransportRouter::CollectMemory(memory::Report& report) const
 	{
-		return ptrRoute_;
+		memory::Counter routes;
+		CountMemory(routes);
+		const std::size_t vertexCount = makedGraph_.GetGraph().GetVertexCount();
+		report.Add("router.routes", vertexCount * vertexCount, routes);
 	}
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 #include "transport_catalogue.h"
 #include "router.h"
+#include "memory_stats.h"
 
 #include <memory>
+#include <optional>
 
 namespace graph {
 
@@ -18,30 +20,50 @@ namespace graph {
 	public:
 		TransportGraph() = default;
 		TransportGraph(const tc::TransportCatalogue & db, double velocity, int waitTime);
+		// graph of base with buses added to catalogue after it, their stops without vertices
+		// and their edges are appended, so vertices and edges of base keep their ids
+		TransportGraph(const TransportGraph& base, const tc::TransportCatalogue& db,
+			const std::vector<const domain::Bus*>& addedBuses);
 
 		const graph::DirectedWeightedGraph<double>& GetGraph() const;
 		const StopNameToVertexId& GetStopIds() const;
 		void SetGraph(graph::DirectedWeightedGraph<double>&& graph);
 		void SetStopIds(StopNameToVertexId&& stop_ids);
+		void SetRoutingSettings(double velocity, int waitTime);
+		double GetVelocity() const;
+		int GetWaitTime() const;
+		// link vertices of restored graph with stops of catalogue
+		void BindStops(const tc::TransportCatalogue& db);
+		// vertex where passenger waits on stop, nullopt for stop out of graph
+		std::optional<graph::VertexId> GetStopVertex(const domain::Stop* stop) const;
+		void CollectMemory(memory::Report& report) const;
 		
 	private:
 		graph::DirectedWeightedGraph<double> graph_;
 		StopNameToVertexId stopIds_;
+		double velocity_{ 0.0 };
+		int waitTime_{ 0 };
+		// id of stop -> its vertex, resolves stops without hashing of names
+		std::vector<graph::VertexId> stopVertices_;
 
 		// set vertex into graph
-		void SetVertex(int waitTime, const std::vector<domain::Stop>& stops);
+		void SetVertex(const std::vector<domain::Stop>& stops);
+		// vertices of waiting on stop and riding from it joined by edge of waiting
+		void AddStopVertices(const domain::Stop& stop);
 		// set edge into graph
 		void SetEdge(double velocity, const tc::TransportCatalogue & db);
+		void AddBusEdges(double velocity, const tc::TransportCatalogue& db, const domain::Bus& bus);
 	};
 
 	class TransportRouter final: public graph::Router<double> {
 	public:
 		TransportRouter(const TransportGraph& makedGraph);
+		// graph extends graph of base, routes of base are reused
+		TransportRouter(const TransportGraph& makedGraph, const TransportRouter& base);
 		
 		const TransportGraph& GetMakedGraph() const;
-		const std::unique_ptr<graph::Router<double>>& GetPtrRoute() const;
+		void CollectMemory(memory::Report& report) const;
 	private:
 		const TransportGraph& makedGraph_;
-		std::unique_ptr<graph::Router<double>> ptrRoute_;
 	};
 }